@@ -6,4 +6,4 @@
  (c-mode
   (indent-tabs-mode . nil))
  (conf-mode
-  (conf-space-keywords . "errno\\|fail\\|name\\|params\\|return")))
+  (conf-space-keywords . "addr\\|errno\\|fail\\|local\\|name\\|params\\|partial\\|peer\\|reset\\|return\\|style\\|vararg")))
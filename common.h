@@ -0,0 +1,196 @@
+/* Copyright 2020-2024 Philip Kaludercic
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Definitions shared between the launcher (main.c) and the preload
+ * library (trip.c).  Both have to define a function "fail" and a
+ * variable "debug_mode". */
+
+#include <arpa/inet.h>
+#include <dlfcn.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <assert.h>
+#undef assert
+
+#include "trip.h"
+
+#define ENVCONFNAME "____TRIP_CONFIGURATION"
+
+#define GS "\035"           /* group separator */
+#define RS "\036"           /* record separator */
+
+#define GLUE(A, B) A ## B
+#define XGLUE(A, B) GLUE(A, B)
+
+#if defined(__has_c_attribute) && __has_c_attribute(noreturn)
+#define noreturn    [[noreturn]]
+#elif defined(__GNUC__) || defined(__clang__) || defined(__INTEL_LLVM_COMPILER)
+#define noreturn    __attribute__ ((noreturn))
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define noreturn    _Noreturn
+#else
+#define noreturn    /**/
+#endif
+
+noreturn static void fail(const char reason[static 1], const bool print_emsg);
+
+/* Declare and format a string on the stack. */
+#define _$sprintf(buf, c, fmt, ...)                             \
+    for (char buf[snprintf(NULL, 0, fmt, __VA_ARGS__) + 1],     \
+             c = !'\0';                                         \
+         c != '\0' &&                                           \
+             (snprintf(buf, sizeof(buf), fmt, __VA_ARGS__), 1); \
+         c = '\0')
+#define $sprintf(buf, ...)                                      \
+    _$sprintf(buf, XGLUE(__c_, __COUNTER__), __VA_ARGS__)
+
+#define failf(fmt, ...)                                 \
+    do $sprintf(_, fmt, __VA_ARGS__) fail(_, false);    \
+    while (0)
+
+#ifdef NDEBUG
+#define assert(_)  do { (void) 0; } while (0)
+#define debug(...) (void) 0
+#define debugf(...) (void) 0
+#else
+
+static void _debug(const char *words[], unsigned n);
+
+static void
+do_assert(const char *val, const char *file, unsigned linenr)
+{
+    $sprintf(line, "(%s:%d)", file, linenr) {
+        _debug((const char*[]){"Assertion failed", val, line}, 3);
+    }
+    abort();
+}
+
+#define assert(val)                                     \
+    do {                                                \
+        if (!(val)) {                                   \
+            do_assert(#val, __FILE__, __LINE__);        \
+        }                                               \
+    } while (0)
+
+static void
+_debug(const char *words[], unsigned n)
+{
+    typedef ssize_t (wt)(int, const void *, size_t);
+    static wt *real_write = NULL;
+    const char *const prefix = "[trip]";
+
+    if (NULL == real_write) {
+        real_write = ((wt*) dlsym(RTLD_NEXT, "write"));
+        assert(NULL != real_write);
+    }
+
+    real_write(STDERR_FILENO, prefix, strlen(prefix));
+
+    for (unsigned i = 0; i < n; ++i) {
+        real_write(STDERR_FILENO, " ", 1);
+        real_write(STDERR_FILENO, words[i], strlen(words[i]));
+    }
+    real_write(STDERR_FILENO, "\n", 1);
+}
+
+#define debug(...)                              \
+    do {                                        \
+        if (!debug_mode) break;                 \
+        const char *words[] = { __VA_ARGS__ };  \
+        _debug(words, LENGTH(words));           \
+    } while (0)
+
+#define debugf(fmt, ...)                        \
+    do {                                        \
+        if (!debug_mode) break;                 \
+        $sprintf(_, fmt, __VA_ARGS__) debug(_); \
+    } while (0)
+
+#endif
+
+/* Parse a network destination SPEC of the form ADDR[/LEN][:PORT],
+ * where ADDR is either an IPv4 address or an IPv6 address in square
+ * brackets.  IPv4 addresses are mapped into ::ffff:0:0/96, so that
+ * both can be stored in ADDR as IPv6 addresses with a prefix of LEN
+ * bits.  A PORT of 0 matches every port. */
+static bool
+parse_dest(const char *spec, unsigned char addr[static 16],
+           unsigned *len, unsigned *port)
+{
+    char buf[INET6_ADDRSTRLEN];
+    const char *end;
+    unsigned offset, max;
+    size_t n;
+
+    if ('[' == spec[0]) {
+        spec++;
+        if (NULL == (end = strchr(spec, ']'))) {
+            return false;
+        }
+        n = (size_t) (end++ - spec);
+        offset = 0;
+        max = 128;
+    } else {
+        n = strspn(spec, "0123456789.");
+        end = spec + n;
+        offset = 96;
+        max = 32;
+    }
+    if (n >= sizeof buf) {
+        return false;
+    }
+    memcpy(buf, spec, n);
+    buf[n] = '\0';
+
+    memset(addr, 0, 16);
+    if (0 == offset) {
+        if (1 != inet_pton(AF_INET6, buf, addr)) {
+            return false;
+        }
+    } else {
+        addr[10] = addr[11] = 0xff;
+        if (1 != inet_pton(AF_INET, buf, addr + 12)) {
+            return false;
+        }
+    }
+
+    char *rest;
+    *len = offset + max;
+    if ('/' == *end) {
+        unsigned long l = strtoul(end + 1, &rest, 10);
+        if (rest == end + 1 || l > max) {
+            return false;
+        }
+        *len = offset + (unsigned) l;
+        end = rest;
+    }
+
+    *port = 0;
+    if (':' == *end) {
+        unsigned long p = strtoul(end + 1, &rest, 10);
+        if (rest == end + 1 || 0 == p || p > 65535) {
+            return false;
+        }
+        *port = (unsigned) p;
+        end = rest;
+    }
+
+    return '\0' == *end;
+}
@@ -0,0 +1,11 @@
+#include "../macs.h"
+#include <fcntl.h>
+DEF_VA(int, open, (const char *pathname, int flags, ...), (pathname, flags, mode), (-1), flags, mode_t , mode,E(EACCES),E(EDQUOT),E(EEXIST),E(EFAULT),E(EFBIG),E(EINTR),E(EISDIR),E(ELOOP),E(EMFILE),E(ENAMETOOLONG),E(ENFILE),E(ENOENT),E(ENOMEM),E(ENOSPC),E(ENOTDIR),E(EPERM),E(EROFS),E(ETXTBSY))
+DEF_VA(int, open64, (const char *pathname, int flags, ...), (pathname, flags, mode), (-1), flags, mode_t , mode,E(EACCES),E(EDQUOT),E(EEXIST),E(EFAULT),E(EFBIG),E(EINTR),E(EISDIR),E(ELOOP),E(EMFILE),E(ENAMETOOLONG),E(ENFILE),E(ENOENT),E(ENOMEM),E(ENOSPC),E(ENOTDIR),E(EPERM),E(EROFS),E(ETXTBSY))
+DEF_VA(int, openat, (int dirfd, const char *pathname, int flags, ...), (dirfd, pathname, flags, mode), (-1), flags, mode_t , mode,E(EACCES),E(EBADF),E(EDQUOT),E(EEXIST),E(EFAULT),E(EFBIG),E(EINTR),E(EISDIR),E(ELOOP),E(EMFILE),E(ENAMETOOLONG),E(ENFILE),E(ENOENT),E(ENOMEM),E(ENOSPC),E(ENOTDIR),E(EPERM),E(EROFS),E(ETXTBSY))
+DEF_VA(int, openat64, (int dirfd, const char *pathname, int flags, ...), (dirfd, pathname, flags, mode), (-1), flags, mode_t , mode,E(EACCES),E(EBADF),E(EDQUOT),E(EEXIST),E(EFAULT),E(EFBIG),E(EINTR),E(EISDIR),E(ELOOP),E(EMFILE),E(ENAMETOOLONG),E(ENFILE),E(ENOENT),E(ENOMEM),E(ENOSPC),E(ENOTDIR),E(EPERM),E(EROFS),E(ETXTBSY))
+DEF_VA_NEW(int, fcntl, (int fd, int cmd, ...), (fd, cmd, arg), (-1), cmd, void *, arg,E(EACCES),E(EAGAIN),E(EBADF),E(EBUSY),E(EDEADLK),E(EINTR),E(EINVAL),E(EMFILE),E(ENOLCK),E(EPERM))
+DEF_VA_NEW(int, fcntl64, (int fd, int cmd, ...), (fd, cmd, arg), (-1), cmd, void *, arg,E(EACCES),E(EAGAIN),E(EBADF),E(EBUSY),E(EDEADLK),E(EINTR),E(EINVAL),E(EMFILE),E(ENOLCK),E(EPERM))
+DEF_ERR(int, posix_fallocate, (int fd, off_t offset, off_t len), (fd, offset, len), (), E(EBADF),E(EFBIG),E(EINTR),E(EINVAL),E(ENODEV),E(ENOSPC),E(EOPNOTSUPP),E(EPERM),E(ESPIPE))
+DEF_ERR(int, posix_fallocate64, (int fd, off64_t offset, off64_t len), (fd, offset, len), (), E(EBADF),E(EFBIG),E(EINTR),E(EINVAL),E(ENODEV),E(ENOSPC),E(EOPNOTSUPP),E(EPERM),E(ESPIPE))
+DEF_SHORT(ssize_t, splice, (int fd_in, off_t *off_in, int fd_out, off_t *off_out, size_t len, unsigned int flags), (fd_in, off_in, fd_out, off_out, len, flags), (-1), len,E(EAGAIN),E(EBADF),E(EINVAL),E(ENOMEM),E(ESPIPE),P(SHORT))
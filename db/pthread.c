@@ -0,0 +1,13 @@
+#include "../macs.h"
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+
+typedef void *(*____trip_start_routine)(void *);
+DEF_ERR(int, pthread_create, (pthread_t *thread, const pthread_attr_t *attr, ____trip_start_routine start_routine, void *arg), (thread, attr, start_routine, arg), (), E(EAGAIN),E(EINVAL),E(EPERM))
+DEF_ERR(int, pthread_mutex_timedlock, (pthread_mutex_t *mutex, const struct timespec *abstime), (mutex, abstime), (), E(EAGAIN),E(EDEADLK),E(EINVAL),E(ETIMEDOUT))
+DEF_ERR(int, pthread_cond_timedwait, (pthread_cond_t *cond, pthread_mutex_t *mutex, const struct timespec *abstime), (cond, mutex, abstime), (), E(EINVAL),E(EPERM),E(ETIMEDOUT))
+DEF_ERR(int, pthread_attr_setstacksize, (pthread_attr_t *attr, size_t stacksize), (attr, stacksize), (), E(EINVAL))
+DEF_ERR(int, pthread_setaffinity_np, (pthread_t thread, size_t cpusetsize, const cpu_set_t *cpuset), (thread, cpusetsize, cpuset), (), E(EFAULT),E(EINVAL),E(ESRCH))
+DEF(int, sem_timedwait, (sem_t *sem, const struct timespec *abs_timeout), (sem, abs_timeout), (-1), E(EINTR),E(EINVAL),E(ETIMEDOUT))
+DEF(int, sched_setaffinity, (pid_t pid, size_t cpusetsize, const cpu_set_t *mask), (pid, cpusetsize, mask), (-1), E(EFAULT),E(EINVAL),E(EPERM),E(ESRCH))
@@ -0,0 +1,19 @@
+#include "../macs.h"
+#include <stdio.h>
+DEF(int, fclose, (FILE *f), (f), (EOF), E(EINTR),E(EIO),E(ENOSPC),E(EDQUOT),E(ENOSPC),E(EPIPE))
+DEF(FILE *, fdopen, (int fd, const char *mode), (fd, mode), (NULL), E(ENOMEM))
+DEF(int, fflush, (FILE *f), (f), (EOF), E(EINTR),E(EIO),E(ENOSPC))
+DEF(int, fgetc, (FILE *f), (f), (EOF), E(EINTR),E(EIO))
+DEF(char*, fgets, (char *b, int s, FILE * f), (b, s, f), (NULL), E(EBADF),E(EINTR),E(EIO),E(EOVERFLOW),E(ENOMEM),E(ENXIO))
+DEF(FILE *, fopen, (const char *f, const char *m), (f, m), (NULL), E(ENOMEM),E(EACCES))
+DEF(FILE *, fopen64, (const char *f, const char *m), (f, m), (NULL), E(ENOMEM),E(EACCES))
+DEF(int, fputc, (int c, FILE *f), (c, f), (EOF), E(EINTR),E(EIO),E(ENOSPC),E(ENOMEM))
+DEF(int, putc, (int c, FILE *f), (c, f), (EOF), E(EINTR),E(EIO),E(ENOSPC),E(ENOMEM))
+DEF(int, fputs, (const char *s, FILE *f), (s, f), (EOF), E(EINTR),E(EIO),E(ENOSPC),E(ENOMEM))
+DEF(size_t, fread, (void *m, size_t s, size_t n, FILE *f), (m, s, n, f), (0), E(EINTR),E(EIO),E(ENOMEM))
+DEF(size_t, fwrite, (const void *m, size_t s, size_t n, FILE *f), (m, s, n, f), (0), E(EINTR),E(EIO),E(ENOSPC),E(ENOMEM))
+DEF(ssize_t, getdelim, (char **p, size_t *n, int d, FILE *f), (p, n, d, f), (-1), E(ENOMEM))
+DEF(ssize_t, getline, (char **p, size_t *n, FILE *f), (p, n, f), (-1), E(ENOMEM))
+DEF(int, puts, (const char *s), (s), (EOF), E(EINTR),E(EIO),E(ENOSPC),E(ENOMEM))
+DEF(int, remove, (const char *fn), (fn), (-1), E(EACCES),E(EBUSY),E(EFAULT),E(EINVAL),E(EIO),E(EISDIR),E(ELOOP),E(ENAMETOOLONG),E(ENOENT),E(ENOMEM),E(ENOTDIR),E(ENOTEMPTY),E(EPERM),E(EROFS))
+DEF(int, rename, (const char *a, const char *b), (a, b), (-1), E(EACCES),E(EBUSY),E(EDQUOT),E(EFAULT),E(ELOOP),E(EMLINK),E(ENAMETOOLONG),E(ENOENT),E(ENOMEM),E(ENOSPC),E(ENOTEMPTY),E(EEXIST),E(EPERM),E(EACCES),E(EROFS))
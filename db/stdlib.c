@@ -0,0 +1,7 @@
+#include "../macs.h"
+#include <stdlib.h>
+DEF(void*, malloc, (size_t size), (size), (NULL), E(ENOMEM))
+DEF(void*, calloc, (size_t nmemb, size_t size), (nmemb, size), (NULL), E(ENOMEM))
+DEF(void*, realloc, (void *ptr, size_t size), (ptr, size), (NULL), E(ENOMEM))
+DEF(int, mkstemp, (char *template), (template), (-1), E(EEXIST))
+DEF(int, mkstemp64, (char *template), (template), (-1), E(EEXIST))
@@ -0,0 +1,3 @@
+#include "../macs.h"
+#include <string.h>
+DEF(char *, strdup, (const char *s), (s), (NULL), E(ENOMEM))
@@ -0,0 +1,3 @@
+#include "../macs.h"
+#include <sys/epoll.h>
+DEF(int, epoll_wait, (int epfd, struct epoll_event *events, int maxevents, int timeout), (epfd, events, maxevents, timeout), (-1), E(EBADF),E(EFAULT),E(EINTR),E(EINVAL))
@@ -0,0 +1,5 @@
+#include "../macs.h"
+#include <sys/mman.h>
+DEF(void *, mmap, (void *addr, size_t length, int prot, int flags, int fd, off_t offset), (addr, length, prot, flags, fd, offset), (MAP_FAILED), E(EACCES),E(EAGAIN),E(EBADF),E(EEXIST),E(EINVAL),E(ENFILE),E(ENODEV),E(ENOMEM),E(EOVERFLOW),E(EPERM),E(ETXTBSY))
+DEF(void *, mmap64, (void *addr, size_t length, int prot, int flags, int fd, off64_t offset), (addr, length, prot, flags, fd, offset), (MAP_FAILED), E(EACCES),E(EAGAIN),E(EBADF),E(EEXIST),E(EINVAL),E(ENFILE),E(ENODEV),E(ENOMEM),E(EOVERFLOW),E(EPERM),E(ETXTBSY))
+DEF(int, msync, (void *addr, size_t length, int flags), (addr, length, flags), (-1), E(EBUSY),E(EINVAL),E(EIO),E(ENOMEM))
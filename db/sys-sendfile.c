@@ -0,0 +1,4 @@
+#include "../macs.h"
+#include <sys/sendfile.h>
+DEF_SHORT(ssize_t, sendfile, (int out_fd, int in_fd, off_t *offset, size_t count), (out_fd, in_fd, offset, count), (-1), count,E(EAGAIN),E(EBADF),E(EFAULT),E(EINVAL),E(EIO),E(ENOMEM),E(EOVERFLOW),E(ESPIPE),P(SHORT))
+DEF_SHORT(ssize_t, sendfile64, (int out_fd, int in_fd, off64_t *offset, size_t count), (out_fd, in_fd, offset, count), (-1), count,E(EAGAIN),E(EBADF),E(EFAULT),E(EINVAL),E(EIO),E(ENOMEM),E(EOVERFLOW),E(ESPIPE),P(SHORT))
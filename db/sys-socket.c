@@ -0,0 +1,14 @@
+#include "../macs.h"
+#include <sys/socket.h>
+DEF_NEW(int, socket, (int domain, int type, int protocol), (domain, type, protocol), (-1), E(EACCES),E(EAFNOSUPPORT),E(EINVAL),E(EMFILE),E(ENFILE),E(ENOBUFS),E(ENOMEM),E(EPROTONOSUPPORT))
+DEF_AT(int, connect, (int sockfd, const struct sockaddr *addr, socklen_t addrlen), (sockfd, addr, addrlen), (-1), ((struct ____trip_where) { .addr = (const struct sockaddr *) addr, .addrlen = addrlen, .fd = sockfd, .reset = true }), E(EACCES),E(EPERM),E(EADDRINUSE),E(EADDRNOTAVAIL),E(EAFNOSUPPORT),E(EBADF),E(ECONNREFUSED),E(ENETUNREACH),E(EPROTOTYPE),E(ETIMEDOUT))
+DEF_AT_NEW(int, accept, (int sockfd, struct sockaddr *addr, socklen_t *addrlen), (sockfd, addr, addrlen), (-1), ((struct ____trip_where) { .fd = sockfd, .local = true }), E(EAGAIN),E(ECONNABORTED),E(EINTR),E(EMFILE),E(ENFILE),E(ENOBUFS),E(ENOMEM),E(EPERM),E(EPROTO))
+DEF_AT_NEW(int, accept4, (int sockfd, struct sockaddr *addr, socklen_t *addrlen, int flags), (sockfd, addr, addrlen, flags), (-1), ((struct ____trip_where) { .fd = sockfd, .local = true }), E(EAGAIN),E(ECONNABORTED),E(EINTR),E(EMFILE),E(ENFILE),E(ENOBUFS),E(ENOMEM),E(EPERM),E(EPROTO))
+DEF_AT(int, listen, (int sockfd, int backlog), (sockfd, backlog), (-1), ((struct ____trip_where) { .fd = sockfd, .local = true }), E(EADDRINUSE))
+DEF_AT(int, bind, (int sockfd, const struct sockaddr *addr, socklen_t addrlen), (sockfd, addr, addrlen), (-1), ((struct ____trip_where) { .addr = (const struct sockaddr *) addr, .addrlen = addrlen, .fd = sockfd, .reset = true }), E(EADDRINUSE),E(EINVAL),E(EACCES),E(ENAMETOOLONG),E(ENOENT),E(ENOMEM))
+DEF_AT_SHORT(ssize_t, send, (int sockfd, const void *buf, size_t len, int flags), (sockfd, buf, len, flags), (-1), ((struct ____trip_where) { .fd = sockfd }), len,E(EAGAIN),E(ECONNRESET),E(EINTR),E(ENOBUFS),E(ENOMEM),E(EPIPE),P(SHORT))
+DEF_AT_SHORT(ssize_t, sendto, (int sockfd, const void *buf, size_t len, int flags, const struct sockaddr *dest_addr, socklen_t addrlen), (sockfd, buf, len, flags, dest_addr, addrlen), (-1), ((struct ____trip_where) { .addr = (const struct sockaddr *) dest_addr, .addrlen = addrlen, .fd = sockfd }), len,E(EAGAIN),E(ECONNRESET),E(EINTR),E(ENOBUFS),E(ENOMEM),E(EPIPE),P(SHORT))
+DEF_AT_SHORT(ssize_t, recv, (int sockfd, void *buf, size_t len, int flags), (sockfd, buf, len, flags), (-1), ((struct ____trip_where) { .fd = sockfd }), len,E(EAGAIN),E(ECONNREFUSED),E(ECONNRESET),E(EINTR),E(ENOMEM),P(SHORT))
+DEF_AT_SHORT(ssize_t, recvfrom, (int sockfd, void *buf, size_t len, int flags, struct sockaddr *src_addr, socklen_t *addrlen), (sockfd, buf, len, flags, src_addr, addrlen), (-1), ((struct ____trip_where) { .fd = sockfd }), len,E(EAGAIN),E(ECONNREFUSED),E(ECONNRESET),E(EINTR),E(ENOMEM),P(SHORT))
+DEF_AT(ssize_t, sendmsg, (int sockfd, const struct msghdr *msg, int flags), (sockfd, msg, flags), (-1), ((struct ____trip_where) { .fd = sockfd }), E(EAGAIN),E(ECONNRESET),E(EINTR),E(EMSGSIZE),E(ENOBUFS),E(ENOMEM),E(EPIPE))
+DEF_AT(ssize_t, recvmsg, (int sockfd, struct msghdr *msg, int flags), (sockfd, msg, flags), (-1), ((struct ____trip_where) { .fd = sockfd }), E(EAGAIN),E(ECONNREFUSED),E(ECONNRESET),E(EINTR),E(ENOMEM))
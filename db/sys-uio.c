@@ -0,0 +1,12 @@
+#include "../macs.h"
+#include <sys/uio.h>
+DEF_SHORT(ssize_t, readv, (int fd, const struct iovec *iov, int iovcnt), (fd, iov, iovcnt), (-1), iovcnt,E(EAGAIN),E(EFAULT),E(EINTR),E(EINVAL),E(EIO),E(EISDIR),P(SHORT))
+DEF_SHORT(ssize_t, writev, (int fd, const struct iovec *iov, int iovcnt), (fd, iov, iovcnt), (-1), iovcnt,E(EAGAIN),E(EDQUOT),E(EFAULT),E(EFBIG),E(EINTR),E(EINVAL),E(EIO),E(ENOSPC),E(EPIPE),P(SHORT))
+DEF_SHORT(ssize_t, preadv, (int fd, const struct iovec *iov, int iovcnt, off_t offset), (fd, iov, iovcnt, offset), (-1), iovcnt,E(EAGAIN),E(EFAULT),E(EINTR),E(EINVAL),E(EIO),E(EISDIR),E(EOVERFLOW),E(ESPIPE),P(SHORT))
+DEF_SHORT(ssize_t, preadv64, (int fd, const struct iovec *iov, int iovcnt, off64_t offset), (fd, iov, iovcnt, offset), (-1), iovcnt,E(EAGAIN),E(EFAULT),E(EINTR),E(EINVAL),E(EIO),E(EISDIR),E(EOVERFLOW),E(ESPIPE),P(SHORT))
+DEF_SHORT(ssize_t, pwritev, (int fd, const struct iovec *iov, int iovcnt, off_t offset), (fd, iov, iovcnt, offset), (-1), iovcnt,E(EAGAIN),E(EDQUOT),E(EFAULT),E(EFBIG),E(EINTR),E(EINVAL),E(EIO),E(ENOSPC),E(ESPIPE),P(SHORT))
+DEF_SHORT(ssize_t, pwritev64, (int fd, const struct iovec *iov, int iovcnt, off64_t offset), (fd, iov, iovcnt, offset), (-1), iovcnt,E(EAGAIN),E(EDQUOT),E(EFAULT),E(EFBIG),E(EINTR),E(EINVAL),E(EIO),E(ENOSPC),E(ESPIPE),P(SHORT))
+DEF_SHORT(ssize_t, preadv2, (int fd, const struct iovec *iov, int iovcnt, off_t offset, int flags), (fd, iov, iovcnt, offset, flags), (-1), iovcnt,E(EAGAIN),E(EFAULT),E(EINTR),E(EINVAL),E(EIO),E(EISDIR),E(EOPNOTSUPP),E(EOVERFLOW),E(ESPIPE),P(SHORT))
+DEF_SHORT(ssize_t, preadv64v2, (int fd, const struct iovec *iov, int iovcnt, off64_t offset, int flags), (fd, iov, iovcnt, offset, flags), (-1), iovcnt,E(EAGAIN),E(EFAULT),E(EINTR),E(EINVAL),E(EIO),E(EISDIR),E(EOPNOTSUPP),E(EOVERFLOW),E(ESPIPE),P(SHORT))
+DEF_SHORT(ssize_t, pwritev2, (int fd, const struct iovec *iov, int iovcnt, off_t offset, int flags), (fd, iov, iovcnt, offset, flags), (-1), iovcnt,E(EAGAIN),E(EDQUOT),E(EFAULT),E(EFBIG),E(EINTR),E(EINVAL),E(EIO),E(ENOSPC),E(EOPNOTSUPP),E(ESPIPE),P(SHORT))
+DEF_SHORT(ssize_t, pwritev64v2, (int fd, const struct iovec *iov, int iovcnt, off64_t offset, int flags), (fd, iov, iovcnt, offset, flags), (-1), iovcnt,E(EAGAIN),E(EDQUOT),E(EFAULT),E(EFBIG),E(EINTR),E(EINVAL),E(EIO),E(ENOSPC),E(EOPNOTSUPP),E(ESPIPE),P(SHORT))
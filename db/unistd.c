@@ -0,0 +1,32 @@
+#include "../macs.h"
+#include <unistd.h>
+DEF(int, unlink, (const char *pathname), (pathname), (-1), E(EACCES),E(EBUSY),E(EFAULT),E(EIO),E(EISDIR),E(ELOOP),E(ENAMETOOLONG),E(ENOENT),E(ENOMEM),E(ENOTDIR),E(EPERM))
+DEF(int, unlinkat, (int dirfd, const char *pathname, int flags), (dirfd, pathname, flags), (-1), E(EACCES),E(EBUSY),E(EFAULT),E(EIO),E(EISDIR),E(ELOOP),E(ENAMETOOLONG),E(ENOENT),E(ENOMEM),E(ENOTDIR),E(EPERM))
+DEF(int, access, (const char *pn, int mo), (pn, mo), (-1), E(EACCES),E(ELOOP),E(ENAMETOOLONG),E(ENOENT),E(ENOTDIR),E(EROFS),E(EFAULT),E(EIO),E(ENOMEM))
+DEF(int, chdir, (const char *pn), (pn), (-1), E(EACCES),E(EFAULT),E(EIO),E(ELOOP),E(ENAMETOOLONG),E(ENOENT),E(ENOMEM),E(ENOTDIR))
+DEF(int, chown, (const char *pn, uid_t o, gid_t g), (pn, o, g), (-1), E(EACCES),E(EFAULT),E(EIO),E(ELOOP),E(ENAMETOOLONG),E(ENOENT),E(ENOMEM),E(ENOTDIR),E(EPERM))
+DEF_AT(int, close, (int fd), (fd), (-1), ((struct ____trip_where) { .fd = fd, .reset = true }), E(EINTR),E(EIO),E(ENOSPC),E(EDQUOT))
+DEF_NEW(int, dup, (int fd), (fd), (-1), E(EBADF),E(EMFILE))
+DEF_AT(int, dup2, (int fd1, int fd2), (fd1, fd2), (-1), ((struct ____trip_where) { .fd = fd2, .reset = true }), E(EBADF),E(EMFILE),E(EIO))
+DEF_AT(int, dup3, (int fd1, int fd2, int flags), (fd1, fd2, flags), (-1), ((struct ____trip_where) { .fd = fd2, .reset = true }), E(EBADF),E(EBUSY),E(EINTR),E(EINVAL),E(EMFILE))
+DEF(int, execv, (const char *file, char *const *argv), (file, argv), (-1), E(EACCES),E(EAGAIN),E(EFAULT),E(EIO),E(EISDIR),E(ELIBBAD),E(ELOOP),E(EMFILE),E(ENOENT),E(ENOEXEC),E(EPERM))
+DEF(int, execve, (const char *file, char *const *argv, char *const *envp), (file, argv, envp), (-1), E(EACCES),E(EAGAIN),E(EFAULT),E(EIO),E(EISDIR),E(ELIBBAD),E(ELOOP),E(EMFILE),E(ENOENT),E(ENOEXEC),E(EPERM))
+DEF(int, execvp, (const char *file, char *const *argv), (file, argv), (-1), E(EACCES),E(EAGAIN),E(EFAULT),E(EIO),E(EISDIR),E(ELIBBAD),E(ELOOP),E(EMFILE),E(ENOENT),E(ENOEXEC),E(EPERM))
+DEF(pid_t, fork, (void), (), (-1), E(EAGAIN),E(ENOMEM))
+DEF(char*, getcwd, (char *buf, size_t size), (buf, size), (NULL), E(EACCES),E(ENOENT),E(ENOMEM))
+DEF(int, gethostname, (char *name, size_t len), (name, len), (-1), E(EPERM))
+DEF(int, link, (const char *old, const char *new), (old, new), (-1), E(EACCES),E(EDQUOT),E(EEXIST),E(EFAULT),E(EIO),E(ELOOP),E(EMLINK),E(ENAMETOOLONG),E(ENOENT),E(ENOMEM),E(ENOTDIR),E(EPERM),E(EROFS))
+DEF_SHORT(ssize_t, read, (int fd, void *m, size_t n), (fd, m, n), (-1), n,E(EAGAIN),E(EFAULT),E(EINTR),E(EIO),E(EISDIR),P(SHORT))
+DEF(ssize_t, readlink, (const char *path, char *buf, size_t size), (path, buf, size), (-1), E(EACCES),E(EINVAL),E(EIO),E(ELOOP),E(ENAMETOOLONG),E(ENOENT),E(ENOTDIR))
+DEF(int, rmdir, (const char *pathname), (pathname), (-1), E(EACCES),E(EBUSY),E(EFAULT),E(EINVAL),E(ELOOP),E(ENAMETOOLONG),E(ENOENT),E(ENOMEM),E(ENOTDIR),E(ENOTEMPTY),E(EPERM),E(EPERM),E(EROFS))
+DEF(int, mkdir, (const char *pathname, mode_t mode), (pathname, mode), (-1), E(EACCES),E(EDQUOT),E(EEXIST),E(EINVAL),E(ELOOP),E(ENAMETOOLONG))
+DEF_SHORT(ssize_t, write, (int fd, const void *m, size_t n), (fd, m, n), (-1), n,E(EAGAIN),E(EDQUOT),E(EFAULT),E(EINTR),E(EIO),E(ENOSPC),P(SHORT))
+DEF(int, faccessat, (int dirfd, const char *pathname, int mode, int flags), (dirfd, pathname, mode, flags), (-1), E(EACCES),E(EBADF),E(EFAULT),E(EIO),E(ELOOP),E(ENOENT),E(ENOMEM),E(ENOTDIR),E(EPERM),E(EROFS),E(ETXTBSY))
+DEF(int, fchdir, (int fd), (fd), (-1), E(EACCES),E(EFAULT),E(EIO),E(ELOOP),E(ENAMETOOLONG),E(ENOENT),E(ENOMEM),E(ENOTDIR))
+DEF(int, fchown, (int fd, uid_t owner, gid_t group), (fd, owner, group), (-1), E(EACCES),E(EBADF),E(EFAULT),E(EIO),E(ELOOP),E(ENAMETOOLONG),E(ENOENT),E(ENOMEM),E(ENOTDIR),E(EPERM),E(EROFS))
+DEF_SHORT(ssize_t, pread, (int fd, void *m, size_t n, off_t o), (fd, m, n, o), (-1), n,E(EAGAIN),E(EFAULT),E(EINTR),E(EIO),E(EISDIR),E(EINVAL),E(ENXIO),E(EOVERFLOW),E(ESPIPE),P(SHORT))
+DEF_SHORT(ssize_t, pread64, (int fd, void *m, size_t n, off64_t o), (fd, m, n, o), (-1), n,E(EAGAIN),E(EFAULT),E(EINTR),E(EIO),E(EISDIR),E(EINVAL),E(ENXIO),E(EOVERFLOW),E(ESPIPE),P(SHORT))
+DEF_SHORT(ssize_t, pwrite, (int fd, const void *m, size_t n, off_t o), (fd, m, n, o), (-1), n,E(EAGAIN),E(EDQUOT),E(EFAULT),E(EFBIG),E(EINTR),E(EIO),E(EINVAL),E(ENOSPC),E(ENXIO),E(ESPIPE),P(SHORT))
+DEF_SHORT(ssize_t, pwrite64, (int fd, const void *m, size_t n, off64_t o), (fd, m, n, o), (-1), n,E(EAGAIN),E(EDQUOT),E(EFAULT),E(EFBIG),E(EINTR),E(EIO),E(EINVAL),E(ENOSPC),E(ENXIO),E(ESPIPE),P(SHORT))
+DEF(int, fsync, (int fd), (fd), (-1), E(EBADF),E(EDQUOT),E(EINTR),E(EIO),E(ENOSPC),E(EROFS))
+DEF(int, fdatasync, (int fd), (fd), (-1), E(EBADF),E(EDQUOT),E(EINTR),E(EIO),E(ENOSPC),E(EROFS))
@@ -41,9 +41,24 @@ function gen() {
         return;
     }
 
+    # The optional argument of a variadic function ("vararg") is
+    # passed on to the next definition after the named arguments.
+    params = data["params"]
+    if ("vararg" in data) {
+        sub(/[[:space:]]*,[[:space:]]*\.\.\.$/, "", params)
+        match(params, /[[:alnum:]_]+$/)
+        last = substr(params, RSTART)
+        match(data["vararg"], /[[:alnum:]_]+$/)
+        type = substr(data["vararg"], 1, RSTART - 1)
+        var = substr(data["vararg"], RSTART)
+    }
+
     args = gensub(/(^|(,))([[:space:]]*[[:alnum:]_]+[[:space:]]*(\*|\[\])*[[:space:]]*)+(\[\]|\*|[[:space:]])[[:space:]]*(const[[:space:]]+)?([[:alnum:]_]+)/,
                   "\\2 \\7", "g",
-                  data["params"])
+                  params)
+    if ("vararg" in data) {
+        args = args ", " var
+    }
 
     if (data["name"] in seen) {
         print "Duplicate entry on ", FILENAME ":" NR > "/dev/stderr"
@@ -53,14 +68,68 @@ function gen() {
 
     errno = gensub(/E[[:alnum:]]*/, "E(\\0)" , "g", data["errno"])
 
-    print                          \
-        "DEF(" data["return"] ",", \
-        data["name"] ",",          \
-        "(" (data["params"]        \
-             ? data["params"]      \
-             : "void") "),",       \
-        "(" args "),",             \
-        "(" data["fail"] "),",     \
+    # Functions with a count that can be shortened ("partial") may
+    # also return less than was requested, see ____TRIP_SHORT.  It has
+    # to come last, as the engine leaves it out of the random errors.
+    if ("partial" in data) {
+        errno = errno (errno ? "," : "") "P(SHORT)"
+    }
+
+    # Functions directed at a network destination are either given an
+    # address and its length ("addr"), or a socket whose peer
+    # ("peer") or local ("local") address should be checked.
+    # Functions that change or close a socket ("reset") invalidate
+    # the addresses trip has cached for it, and those that return a
+    # new descriptor ("reset return") the addresses of that one.
+    fresh = ("reset" in data) && data["reset"] == "return"
+    if (fresh) {
+        delete data["reset"]
+    }
+    where = ""
+    if ("addr" in data) {
+        split(data["addr"], addr, /[[:space:]]*,[[:space:]]*/)
+        where = ".addr = (const struct sockaddr *) " addr[1] \
+            ", .addrlen = " addr[2]
+    }
+    if ("peer" in data || "local" in data) {
+        where = where (where ? ", " : "") ".fd = " \
+            ("peer" in data ? data["peer"] : data["local"] ", .local = true")
+    } else if ("reset" in data) {
+        where = where (where ? ", " : "") ".fd = " data["reset"]
+    } else if (where) {
+        where = where ", .fd = -1"
+    }
+    if ("reset" in data) {
+        where = where ", .reset = true"
+    }
+
+    if ("vararg" in data) {
+        kind = "_VA"
+    } else if (data["style"] == "errno") {
+        # Functions that return an error number instead of setting
+        # errno need no "fail" value.
+        kind = "_ERR"
+    } else {
+        kind = (where ? "_AT" : "") ("partial" in data ? "_SHORT" : "")
+    }
+    if (fresh) {
+        kind = kind "_NEW"
+    }
+
+    print                                     \
+        "DEF" kind "("                        \
+        data["return"] ",",                   \
+        data["name"] ",",                     \
+        "(" (data["params"]                   \
+             ? data["params"]                 \
+             : "void") "),",                  \
+        "(" args "),",                        \
+        "(" data["fail"] "),",                \
+        (where                                \
+         ? "((struct ____trip_where) { " where " }),"   \
+         : "")                                \
+        ("partial" in data ? data["partial"] "," : "")  \
+        ("vararg" in data ? last ", " type ", " var "," : "") \
         errno ")"
     delete data;
 }
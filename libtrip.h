@@ -0,0 +1,99 @@
+/* Copyright 2024 Philip Kaludercic
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* In-process interface to trip.  Programs linked against libtrip.so
+ * can change which functions should fail at runtime, without having
+ * to re-execute themselves using trip(1) for every scenario.  All
+ * functions that return an int return 0 on success, and -1 with errno
+ * set otherwise. */
+
+#ifndef LIBTRIP_H
+#define LIBTRIP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The library is built with hidden visibility by default */
+#if defined(__GNUC__) || defined(__clang__)
+#define TRIP_EXPORT __attribute__((visibility("default")))
+#else
+#define TRIP_EXPORT
+#endif
+
+/* Number of calls probed and tripped by the rules of a function */
+struct trip_count {
+    unsigned long calls;
+    unsigned long trips;
+};
+
+/* Saved state of a scoped rule, see TRIP_SCOPE */
+struct trip_guard {
+    const char *func;
+    void *saved;                /* previous rules for FUNC */
+    unsigned nsaved;
+    int state;
+};
+
+/* Make FUNC fail with the probability CHANCE (between 0 and 1),
+ * setting errno to ERROR or a random expected value if ERROR is 0.
+ * All existing rules for FUNC are replaced, including their
+ * qualifiers. */
+TRIP_EXPORT int trip_set(const char *func, double chance, int error);
+
+/* Remove all rules for FUNC */
+TRIP_EXPORT int trip_unset(const char *func);
+
+/* Remove all rules */
+TRIP_EXPORT void trip_clear(void);
+
+/* Store the statistics for the current rules of FUNC, or of all rules
+ * if FUNC is NULL, in STATS.  The statistics are no longer updated
+ * after the overhead budget has been exceeded, see trip(1). */
+TRIP_EXPORT int trip_stats(const char *func, struct trip_count *stats);
+
+/* Set a rule as with trip_set, remembering the previous rules for FUNC
+ * so that they can be restored by trip_guard_release. */
+TRIP_EXPORT struct trip_guard trip_guard_acquire(const char *func, double chance, int error);
+TRIP_EXPORT void trip_guard_release(struct trip_guard *guard);
+
+#define TRIP_GLUE(A, B) A ## B
+#define TRIP_XGLUE(A, B) TRIP_GLUE(A, B)
+
+/* Trip FUNC until the end of the current block */
+#define TRIP_SCOPE(func, chance, error)                                 \
+    struct trip_guard TRIP_XGLUE(trip_guard_, __COUNTER__)              \
+        __attribute__((cleanup(trip_guard_release))) =                  \
+        trip_guard_acquire(func, chance, error)
+
+#ifdef __cplusplus
+}
+
+namespace trip {
+    /* Trip a function during the lifetime of the guard object */
+    class guard {
+        struct trip_guard g;
+    public:
+        guard(const char *func, double chance = 1, int error = 0)
+            : g(trip_guard_acquire(func, chance, error)) {}
+        ~guard() { trip_guard_release(&g); }
+        guard(const guard &) = delete;
+        guard &operator=(const guard &) = delete;
+    };
+}
+#endif
+
+#endif /* LIBTRIP_H */
@@ -13,23 +13,127 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
-
 #define _GNU_SOURCE
 
 #include <dlfcn.h>
 #include <errno.h>
+#include <stdarg.h>
 
 #include "trip.h"
 
-#ifndef DEF
-#define DEF(ret, name, params, args, fail, ...)				\
-     ret name params {							\
+/* Common body of all stubs.  SETUP is run first, WHERE points to the
+ * network destination of the call (or is NULL), and PART is a count
+ * that the predicate may shorten instead of failing the call, which
+ * STORE then writes back into the arguments.  AFTER is run once the
+ * real call has returned ____trip_ret, and then the stub waits for
+ * the jitter the predicate asked for.  The jitter is taken over right
+ * away, as the real call might invoke other stubs. */
+#define ____TRIP_STUB(ret, name, params, args, fail, setup, where, part, store, after, ...) \
+     __attribute__((visibility("default"))) ret name params {		\
           typedef ret (*real) params;					\
+          static real next = NULL;					\
           int errv[] = { __VA_ARGS__ };					\
-          return ____trip_should_fail(#name, errv, LENGTH(errv))	\
-               ? fail							\
-               : (((real) dlsym(RTLD_NEXT, #name)) args);		\
+          setup;							\
+          size_t ____trip_count = part;					\
+          if (NULL == next) {						\
+               next = (real) dlsym(RTLD_NEXT, #name);			\
+          }								\
+          if (____trip_should_fail_at(#name, where, &____trip_count,	\
+                                      errv, LENGTH(errv))) {		\
+               return fail;						\
+          }								\
+          unsigned ____trip_ms = ____trip_jitter;			\
+          ____trip_jitter = 0;						\
+          store;							\
+          ret ____trip_ret = next args;					\
+          after;							\
+          if (0 < ____trip_ms) {					\
+               ____trip_late(____trip_ms);				\
+          }								\
+          return ____trip_ret;						\
      }
+
+#define ____TRIP_SHORTEN(part) part = (__typeof__(part)) ____trip_count
+
+/* Fetch the optional argument VAR of a variadic function */
+#define ____TRIP_VARARG(last, type, var)				\
+     va_list ap;							\
+     va_start(ap, last);						\
+     type var = va_arg(ap, type);					\
+     va_end(ap)
+
+#ifndef DEF
+#define DEF(ret, name, params, args, fail, ...)				\
+     ____TRIP_STUB(ret, name, params, args, fail, (void) 0, NULL,	\
+                   0, (void) 0, (void) 0, __VA_ARGS__)
+#endif
+
+#ifndef DEF_AT
+#define DEF_AT(ret, name, params, args, fail, where, ...)		\
+     ____TRIP_STUB(ret, name, params, args, fail, (void) 0, &where,	\
+                   0, (void) 0, (void) 0, __VA_ARGS__)
+#endif
+
+#ifndef DEF_SHORT
+#define DEF_SHORT(ret, name, params, args, fail, part, ...)		\
+     ____TRIP_STUB(ret, name, params, args, fail, (void) 0, NULL,	\
+                   (size_t) part, ____TRIP_SHORTEN(part), (void) 0,	\
+                   __VA_ARGS__)
+#endif
+
+#ifndef DEF_AT_SHORT
+#define DEF_AT_SHORT(ret, name, params, args, fail, where, part, ...)	\
+     ____TRIP_STUB(ret, name, params, args, fail, (void) 0, &where,	\
+                   (size_t) part, ____TRIP_SHORTEN(part), (void) 0,	\
+                   __VA_ARGS__)
+#endif
+
+#ifndef DEF_ERR
+/* Functions that return an error number instead of setting errno */
+static inline int
+____trip_swap_errno(int saved)
+{
+     int error = errno;
+     errno = saved;
+     return error;
+}
+
+#define DEF_ERR(ret, name, params, args, fail, ...)			\
+     ____TRIP_STUB(ret, name, params, args,				\
+                   ____trip_swap_errno(____trip_errno),		\
+                   int ____trip_errno = errno, NULL,			\
+                   0, (void) 0, (void) 0, __VA_ARGS__)
+#endif
+
+#ifndef DEF_VA
+#define DEF_VA(ret, name, params, args, fail, last, type, var, ...)	\
+     ____TRIP_STUB(ret, name, params, args, fail,			\
+                   ____TRIP_VARARG(last, type, var), NULL,		\
+                   0, (void) 0, (void) 0, __VA_ARGS__)
+#endif
+
+/* Functions that return a new descriptor, whose cached addresses
+ * have to be forgotten (see the "reset" field in gen.awk) */
+#define ____TRIP_RENEW ____trip_renew((int) ____trip_ret)
+
+#ifndef DEF_NEW
+#define DEF_NEW(ret, name, params, args, fail, ...)			\
+     ____TRIP_STUB(ret, name, params, args, fail, (void) 0, NULL,	\
+                   0, (void) 0, ____TRIP_RENEW, __VA_ARGS__)
+#endif
+
+#ifndef DEF_AT_NEW
+#define DEF_AT_NEW(ret, name, params, args, fail, where, ...)		\
+     ____TRIP_STUB(ret, name, params, args, fail, (void) 0, &where,	\
+                   0, (void) 0, ____TRIP_RENEW, __VA_ARGS__)
+#endif
+
+#ifndef DEF_VA_NEW
+#define DEF_VA_NEW(ret, name, params, args, fail, last, type, var, ...) \
+     ____TRIP_STUB(ret, name, params, args, fail,			\
+                   ____TRIP_VARARG(last, type, var), NULL,		\
+                   0, (void) 0, ____TRIP_RENEW, __VA_ARGS__)
 #endif
 
 #define E(e) e
+#define P(e) ____TRIP_SHORT
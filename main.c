@@ -0,0 +1,641 @@
+/* Copyright 2020-2024 Philip Kaludercic
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.  This program is
+ * distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+ * License for more details. You should have received a copy of the
+ * GNU General Public License along with this program.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/* The trip launcher parses the command line and executes the command
+ * with the preload library (see trip.c) and the configuration in its
+ * environment. */
+
+#define _GNU_SOURCE
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <sys/wait.h>
+
+#include "common.h"
+
+#define VERSION "0.1.0"
+#define USAGE "Usage: %s [func[@qualifier...][:chance[:errno]]][,...] command args\n"
+#define PRELOAD "libtrip-preload.so"
+
+#ifndef COMPILER
+#define COMPILER "unknown"
+#endif
+
+#define DELIM ":/"         /* delimiters in the skip configuration */
+
+/* Parsed command line */
+static unsigned count = 0;
+static struct entry {
+    const char *name;
+    double chance;
+    int error;
+    unsigned nquals;
+    char *quals[8];
+} entries[1 << 8];
+
+/* print debugging information to standard error */
+static bool debug_mode = false;
+
+/* coverage map for the exploration mode */
+static const char *covmap_path = NULL;
+
+/* programs in the scope of trip */
+static const char *only = NULL;
+static unsigned long exec_depth = 0;
+
+/* share of the CPU time trip may use, in percent, or 0 */
+static double overhead = 0;
+
+/* list of known commands */
+#define DEF(ret, name, params, args, fail, ...)	{ #name, { __VA_ARGS__ }, false },
+#define DEF_AT(ret, name, params, args, fail, where, ...)	\
+    { #name, { __VA_ARGS__ }, true },
+#define DEF_SHORT(ret, name, params, args, fail, part, ...)	\
+    { #name, { __VA_ARGS__ }, false },
+#define DEF_AT_SHORT(ret, name, params, args, fail, where, part, ...)	\
+    { #name, { __VA_ARGS__ }, true },
+#define DEF_VA(ret, name, params, args, fail, last, type, var, ...)	\
+    { #name, { __VA_ARGS__ }, false },
+#define DEF_ERR DEF
+#define DEF_NEW DEF
+#define DEF_AT_NEW DEF_AT
+#define DEF_VA_NEW DEF_VA
+#define E(e) { .no = e, .name = #e }
+#define P(e) { .no = ____TRIP_SHORT, .name = #e }
+static struct entry_name {
+    const char *const name;
+    struct {
+        int no;
+        const char *const name;
+    } errs[256/sizeof(int)-sizeof(char*)]; /* adjust if necessary */
+    bool net;                   /* has a network destination */
+} names[] = {
+#include "/dev/stdin"
+};
+#undef P
+#undef E
+#undef DEF_ERR
+#undef DEF_VA
+#undef DEF_AT_SHORT
+#undef DEF_SHORT
+#undef DEF_AT
+#undef DEF
+
+static const char *argv0;
+
+noreturn static void
+fail(const char reason[static 1], const bool print_emsg)
+{
+    dprintf(STDERR_FILENO, "%s: %s%s%s\n",
+            argv0,
+            reason,
+            print_emsg ? ": ": "",
+            print_emsg ? strerror(errno) : "");
+    exit(EXIT_FAILURE);
+}
+
+/* Helper function for qsort and bsearch */
+static int
+compar_name(const void *a, const void *b)
+{
+    return strcmp((((struct entry_name *) a))->name,
+                  (((struct entry_name *) b))->name);
+}
+
+/* Check if a function is supported by trip */
+static const char* __attribute__((pure))
+check(const char *fn)
+{
+    struct entry_name *entry =
+        bsearch(&((struct entry_name) { .name = (const char * const) fn }),
+                names,
+                LENGTH(names),
+                sizeof(struct entry_name),
+                compar_name);
+    return entry != NULL ? entry->name : NULL;
+}
+
+/* Return the end of the qualifier Q, that followed an "@" in a
+ * specification.  A qualifier is either a network destination of the
+ * form ADDR[/LEN][:PORT] (see common.h:/parse_dest/) or KEY=VALUE.  As
+ * the colon also separates the chance, a number after a destination
+ * is only regarded as a port if it is greater than one. */
+static char *
+qualifier(char *q)
+{
+    if ('[' == *q) {
+        char *close = strchr(q, ']');
+        q = NULL != close ? close + 1 : q + strlen(q);
+    } else if (isdigit((unsigned char) *q)) {
+        q += strspn(q, "0123456789.");
+    } else {
+        return q + strcspn(q, DELIM "@");
+    }
+
+    if ('/' == *q) {
+        q += 1 + strspn(q + 1, "0123456789");
+    }
+    if (':' == *q) {
+        size_t n = strspn(q + 1, "0123456789");
+        if (0 < n && NULL != strchr(":@", q[1 + n]) && 1 < atol(q + 1)) {
+            q += 1 + n;
+        }
+    }
+    return q;
+}
+
+/* Parse and add an ENTRY to the table entries. */
+static void
+enter(char *entry)
+{
+    char *func, *chance, *error;
+    char *quals[LENGTH(entries->quals)];
+    unsigned nquals = 0;
+    bool delay = false;
+
+    /* Extract all qualifiers, so that only the function name, the
+     * chance and the error remain in ENTRY. */
+    char *r = entry, *w = entry;
+    while ('\0' != *r) {
+        if ('@' != *r) {
+            *w++ = *r++;
+            continue;
+        }
+
+        char *end = qualifier(++r);
+        if (end == r) {
+            fail("Must pass a non-empty qualifier", false);
+        }
+        if (nquals >= LENGTH(quals)) {
+            failf("Too many qualifiers (%u >= %u)", nquals, LENGTH(quals));
+        }
+        quals[nquals] = strndup(r, (size_t) (end - r));
+        if (NULL == quals[nquals]) {
+            fail("strndup", true);
+        }
+        delay |= !strncmp(quals[nquals], "delay=", 6)
+            || !strncmp(quals[nquals], "jitter=", 7);
+        nquals++;
+        r = end;
+    }
+    *w = '\0';
+
+    func = strtok(entry, DELIM);
+    if (!func) {
+        fail("Must pass a non-empty function name\n", false);
+    }
+    if (check(func) == NULL) {
+        failf("Unknown function \"%s\", cannot trip", func);
+    }
+
+    chance = strtok(NULL, DELIM);
+    if (NULL == chance) {
+        error = NULL;
+        goto skip;
+    }
+    error = strtok(NULL, DELIM);
+
+    if (NULL == error && NULL != chance
+        && (tolower(chance[0]) == 'e' || !strcasecmp(chance, "short"))) {
+        error = chance;
+        chance = NULL;
+    }
+
+  skip:
+    entries[count] = (struct entry) { .name = func, .nquals = nquals };
+
+    for (unsigned i = 0; i < nquals; ++i) {
+        const char *q = entries[count].quals[i] = quals[i];
+        unsigned char addr[16];
+        unsigned len, port;
+
+        if ('[' == q[0] || isdigit((unsigned char) q[0])) {
+            if (!parse_dest(q, addr, &len, &port)) {
+                failf("Cannot parse destination \"%s\"", q);
+            }
+            for (unsigned j = 0; j < LENGTH(names); ++j) {
+                if (!strcmp(names[j].name, func) && !names[j].net) {
+                    failf("%s has no network destination", func);
+                }
+            }
+        } else if (!strncmp(q, "delay=", 6)) {
+            if ('\0' == q[6] || strspn(q + 6, "0123456789") != strlen(q + 6)) {
+                failf("Cannot parse delay \"%s\"", q + 6);
+            }
+        } else if (!strncmp(q, "jitter=", 7)) {
+            if ('\0' == q[7] || strspn(q + 7, "0123456789") != strlen(q + 7)) {
+                failf("Cannot parse jitter \"%s\"", q + 7);
+            }
+        } else if (!strncmp(q, "thread=", 7)) {
+            if (strlen(q + 7) >= 32) {
+                failf("Thread pattern \"%s\" is too long", q + 7);
+            }
+        } else if (!strncmp(q, "tid=", 4)) {
+            if ('\0' == q[4] || strspn(q + 4, "0123456789") != strlen(q + 4)) {
+                failf("Cannot parse thread ID \"%s\"", q + 4);
+            }
+        } else {
+            failf("Unknown qualifier \"%s\"", q);
+        }
+    }
+
+    char *end;
+    errno = 0;
+    double num = 1;
+    if (NULL != chance) {
+        num = strtod(chance, &end);
+        if (*end != '\0' || (num == 0 && errno != 0)) {
+            failf("Cannot parse chance \"%s\"", chance);
+        }
+    }
+
+    if (0 > num || (0 == num && !delay)) {
+        failf("The chance %s (for %s) is not positive", chance,
+              func);
+    }
+    if (1 >= num) {
+        entries[count].chance = num;
+    } else {
+        failf("The chance %g (for %s) is greater than 1", num,
+              func);
+    }
+
+    if (NULL != error) {
+        for (unsigned i = 0; i < strlen(error); ++i) {
+            error[i] = (char) toupper((unsigned char) error[i]);
+        }
+        for (unsigned i = 0; i < LENGTH(names); ++i) {
+            if (!strcmp(names[i].name, func)) {
+                for (unsigned j = 0; j < LENGTH(names[i].errs); ++j) {
+                    if (!strcmp(names[i].errs[j].name, error)) {
+                        entries[count].error = names[i].errs[j].no;
+                        goto found_it;
+                    }
+                }
+                break;
+            }
+        }
+        failf("%s is not expected to return %s", func, error);
+
+      found_it:
+        ;
+    }
+
+    count++;
+}
+
+/* List all supported functions */
+noreturn static void
+list(const char *unused)
+{
+    (void) unused;
+    for (unsigned i = 0; i < LENGTH(names); ++i) {
+        puts(names[i].name);
+    }
+    exit(EXIT_SUCCESS);
+}
+
+/* List all supported errno values for func. */
+noreturn static void
+list_errors(const char *func)
+{
+    if (check(func) == NULL) {
+        failf("Unknown function \"%s\"", func);
+    }
+
+    for (unsigned i = 0; i < LENGTH(names); ++i) {
+        if (!strcmp(names[i].name, func)) {
+            for (unsigned j = 0; names[i].errs[j].no != 0; ++j) {
+                puts(names[i].errs[j].name);
+            }
+            exit(EXIT_SUCCESS);
+        }
+    }
+
+    abort();
+}
+
+/* print a list of all functions that trip could affect */
+noreturn static void
+check_exec(const char *exec)
+{
+    FILE *nm;
+    char line[BUFSIZ], *PATH, *dir = NULL, *func;
+    int status, fd;
+
+    PATH = getenv("PATH");
+    if (NULL == PATH) {
+        fail("no $PATH set", false);
+    }
+
+    $sprintf(path_cpy, ".:%s", PATH) {
+        nm = NULL;
+        while ((dir = strtok(dir == NULL ? path_cpy : NULL, ":"))) {
+            debugf("looking for %s in '%s'...", exec, dir);
+            fd = open(dir, O_DIRECTORY);
+            if (-1 == fd) { continue; } /* invalid component */
+
+            if (0 == faccessat(fd, exec, X_OK, AT_EACCESS)) {
+                debugf("found %s in '%s'", exec, dir);
+                close(fd);
+
+                assert(NULL != dir);
+                $sprintf(cmd, "nm -uP '%s/%s'", dir, exec) {
+                    debugf("executing \"%s\"", cmd);
+                    nm = popen(cmd, "r");
+                }
+                if (NULL == nm) {
+                    fail("popen", true);
+                }
+                break;
+            }
+            close(fd);
+        }
+        if (dir == NULL) {
+            failf("failed to locate %s in $PATH", exec);
+        }
+    }
+    assert(nm != NULL);
+
+    while (NULL != fgets(line, sizeof line, nm)) {
+        func = strtok(line, " @");
+        if (func == NULL || check(func) == NULL) {
+            continue;
+        }
+
+        puts(func);
+    }
+    if (ferror(nm)) {
+        fail("fgets", true);
+    }
+
+    status = pclose(nm);
+    if (-1 == status) {
+        fail("pclose", true);
+    }
+    if (!WIFEXITED(status)) {
+        fail("nm failed to terminate normally", false);
+    }
+    if (0 != WEXITSTATUS(status)) {
+        failf("nm failed with status %d", WEXITSTATUS(status));
+    }
+
+    exit(EXIT_SUCCESS);
+}
+
+noreturn static void
+version(const char *unused)
+{
+    (void) unused;
+    dprintf(STDOUT_FILENO,
+            "version \t" VERSION "\n"
+            "compiler\t" COMPILER "\n"
+            "built   \t" __DATE__ ", " __TIME__ "\n") ;
+    exit(EXIT_SUCCESS);
+}
+
+/* Print a usage string and terminate */
+noreturn static void
+usage(const char *argv0)
+{
+    dprintf(STDERR_FILENO, USAGE, argv0);
+    dprintf(STDERR_FILENO, "Flags:\n"
+            "\t-l\tList all supported functions\n"
+            "\t-e FUNC\tList all errno values for FUNC\n"
+            "\t-c EXEC\tList all tripable functions in EXEC\n"
+            "\t-m FILE\tTrip each new call site once, recording it in FILE\n"
+            "\t-o GLOB\tOnly trip programs whose name or path match GLOB\n"
+            "\t-n N\tOnly trip programs up to N exec calls from trip\n"
+            "\t-O PCT\tFall back to cheaper modes above PCT%% CPU overhead\n"
+#ifndef NDEBUG
+            "\t-d\tPrint debugging information\n"
+#endif
+            "\t-V\tPrint version and build information\n"
+            "\t-h\tPrint this message\n");
+    exit(EXIT_SUCCESS);
+}
+
+int
+main(int argc, char *argv[])
+{
+    _Static_assert(0 < LENGTH(names), "The names array is empty");
+
+    argv0 = argv[0];
+
+    /* If the environmental variable is set, we are currently being
+     * invoked instead of the actual main function.  As this is not
+     * intended, we abort execution immediately. */
+    char *conf = getenv(ENVCONFNAME);
+    if (conf) {
+        dprintf(STDERR_FILENO, "Don't trip me\n");
+        exit(EXIT_FAILURE);
+    }
+
+    struct option {
+        void (*fn)(const char *); char *arg;
+    } options[1 << CHAR_BIT] = {
+    ['l'] = { list,          NULL    },
+    ['e'] = { list_errors,   NULL    },
+    ['c'] = { check_exec,    NULL    },
+    ['V'] = { version,       NULL    },
+    ['h'] = { usage,         argv[0] },
+    };
+    struct option *choice = NULL;
+
+    /* Otherwise we are being invoked to wrap an actual call.  Let us *
+     * start by parsing the command line. */
+    int opt;
+    while ((opt = getopt(argc, argv, "dle:c:m:o:n:O:Vh")) != -1) {
+        switch (opt) {
+        case 'm':
+            covmap_path = optarg;
+            break;
+        case 'o':
+            only = optarg;
+            break;
+        case 'n': {
+            char *end;
+            errno = 0;
+            exec_depth = strtoul(optarg, &end, 10);
+            if ('\0' == optarg[0] || '\0' != *end || 0 != errno || 0 == exec_depth) {
+                failf("Invalid exec depth \"%s\"", optarg);
+            }
+            break;
+        }
+        case 'O': {
+            char *end;
+            errno = 0;
+            overhead = strtod(optarg, &end);
+            if ('%' == *end) {
+                end++;
+            }
+            if (end == optarg || '\0' != *end || 0 != errno
+                || !(0 < overhead && overhead <= 100)) {
+                failf("Invalid overhead budget \"%s\"", optarg);
+            }
+            break;
+        }
+        case 'd':
+#ifndef NDEBUG
+            debug_mode = true;
+#else
+            fail("trip not build with debugging option", false);
+#endif
+            break;
+        default:
+            if (NULL == options[opt].fn) {
+                exit(EXIT_FAILURE); /* "invalid option" */
+            }
+            if (NULL != choice) {
+                fail("contradictory flags", false);
+            }
+
+            choice = &options[opt];
+            if (choice->arg == NULL) {
+                choice->arg = optarg;
+            }
+        }
+    }
+    if (choice != NULL) {
+        /* if we have selected a specific mode of operation, the
+         * remaining flags will be ignored.  To avoid accidentally
+         * passing too many arguments that are then silently ignored,
+         * we instead remind the user of how to use Trip. */
+        if (optind < argc) {
+            usage(argv[0]);
+        }
+
+        assert(NULL != choice->fn);
+        choice->fn(choice->arg);
+    }
+
+    if (optind >= argc) {
+        usage(argv[0]);
+    }
+
+    char *entry = NULL, *s;
+    entry = strtok_r(argv[optind++], ",", &s);
+    do {
+        enter(entry);
+    } while ((entry = strtok_r(NULL, ",", &s)));
+
+    if (optind >= argc) {
+        usage(argv[0]);
+    }
+
+    /* Construct configuration */
+    conf = NULL;
+    size_t size = 0;
+    FILE *h = open_memstream(&conf, &size);
+    if (NULL == h) {
+        fail("open_memstream", true);
+    }
+
+    if (0 > fprintf(h, "%s=", ENVCONFNAME)) {
+        fail("printf", true);
+    }
+    if (debug_mode) {
+        if (EOF == putc('D', h)) {
+            fail("putc", true);
+        }
+    }
+    /* The scope is checked first, so that processes outside of it can
+     * skip the remaining configuration.  The exec depth comes before
+     * the pattern, as it is updated even out of scope. */
+    if (0 != exec_depth) {
+        /* The library updates the depth in-place (see
+         * trip.c:/^scope/), so it has a fixed width. */
+        if (0 > fprintf(h, "-n" GS "%lu:0000" RS, exec_depth)) {
+            fail("printf", true);
+        }
+    }
+    if (NULL != only) {
+        if (0 > fprintf(h, "-o" GS "%s" RS, only)) {
+            fail("printf", true);
+        }
+    }
+    if (0 != overhead) {
+        if (0 > fprintf(h, "-O" GS "%a" RS, overhead)) {
+            fail("printf", true);
+        }
+    }
+    if (NULL != covmap_path) {
+        /* The traced program might change its working directory. */
+        char *cwd = '/' == covmap_path[0] ? NULL : getcwd(NULL, 0);
+        if (0 > fprintf(h, "-m" GS "%s%s%s" RS,
+                        cwd ? cwd : "", cwd ? "/" : "", covmap_path)) {
+            fail("printf", true);
+        }
+        free(cwd);
+    }
+    for (unsigned i = 0; i < count; ++i) {
+        if (0 > fprintf(h, "%s" GS "%a" GS "%x",
+                        entries[i].name, entries[i].chance,
+                        entries[i].error)) {
+            fail("printf", true);
+        }
+        for (unsigned j = 0; j < entries[i].nquals; ++j) {
+            if (0 > fprintf(h, GS "%s", entries[i].quals[j])) {
+                fail("printf", true);
+            }
+        }
+        if (EOF == fputs(RS, h)) {
+            fail("fputs", true);
+        }
+    }
+    fclose(h);
+
+    /* Locate the preload library, either next to the launcher (in
+     * the build directory) or in the "lib" directory of the
+     * installation prefix. */
+    for (size_t size = 1<<6; ; size += 1<<6) {
+        char exe[size];
+        debugf("resolving /proc/self/exe with %lu byte", size);
+
+        memset(exe, '\0', sizeof exe);
+#ifdef __linux__
+        ssize_t ret = readlink("/proc/self/exe", exe, sizeof exe);
+
+        assert(-1 <= ret);
+        if (-1 == ret) {
+            fail("readlink", true);
+        }
+        if (sizeof exe == (size_t) ret) {
+            /* the memory automatically allocated in EXE was not
+             * sufficient to store the resolved file name.  We will
+             * proceed to allocate more memory and and attempt
+             * resolving the symbolic link path again. */
+            continue;
+        }
+        assert('\0' == exe[(size_t)ret]);
+#else
+#error "System is not supported"
+#endif
+
+        char *slash = strrchr(exe, '/');
+        assert(NULL != slash);
+        *slash = '\0';
+
+        $sprintf(local, "LD_PRELOAD=%s/" PRELOAD, exe)
+        $sprintf(installed, "LD_PRELOAD=%s/../lib/" PRELOAD, exe) {
+            char *preload = 0 == access(strchr(local, '=') + 1, R_OK)
+                ? local : installed;
+            debug("preloading", strchr(preload, '=') + 1);
+            execvpe(argv[optind], argv + optind, (char*[]) {preload, conf, NULL});
+        }
+        fail("exec", true);
+    }
+}
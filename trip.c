@@ -12,62 +12,94 @@
  * <https://www.gnu.org/licenses/>.
  */
 
+/* The preload library, that decides what calls the trip stubs (see
+ * macs.h) should fail.  It is configured by the launcher (main.c)
+ * using the environment, or at runtime using the interface declared
+ * in libtrip.h. */
+
 #define _GNU_SOURCE
 
 #include <ctype.h>
-#include <dlfcn.h>
 #include <fcntl.h>
 #include <errno.h>
 #include <limits.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdarg.h>
 #include <stdatomic.h>
-#include <stdbool.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/time.h>
-#include <unistd.h>
-
-#include <assert.h>
-#undef assert
-
-#include "trip.h"
-
-#define ENVCONFNAME "____TRIP_CONFIGURATION"
-#define VERSION "0.1.0"
-#define USAGE "Usage: %s [func[:chance[:errno]]][,...] command args\n"
-
-#ifndef COMPILER
-#define COMPILER "unknown"
-#endif
-
-#define GS "\035"           /* group separator */
-#define RS "\036"           /* record separator */
-#define DELIM ":/"         /* delimiters in the skip configuration */
-
-#define GLUE(A, B) A ## B
-#define XGLUE(A, B) GLUE(A, B)
-
-#if defined(__has_c_attribute) && __has_c_attribute(noreturn)
-#define noreturn    [[noreturn]]
-#elif defined(__GNUC__) || defined(__clang__) || defined(__INTEL_LLVM_COMPILER)
-#define noreturn    __attribute__ ((noreturn))
-#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
-#define noreturn    _Noreturn
-#else
-#define noreturn    /**/
-#endif
+#include <time.h>
+
+#include "common.h"
+#include "libtrip.h"
+
+#define SITE_DEPTH 4        /* return addresses hashed into a call site */
+#define COVMAP_MAGIC 0x766f632070697274UL /* "trip cov", little endian */
+#define COVMAP_SLOTS (1UL << 16)
+#define COVMAP_PROBE 64    /* slots inspected for a call site */
+#define DESTS 8             /* network destinations per entry */
+#define PEERS 1024          /* sockets whose addresses are cached */
+#define SPARSE 0.1          /* rules with a lower chance use skip counters */
+#define SPARSE_MAX 0.3      /* ...or up to this one, to save time */
+#define OVERHEAD_SAMPLE 64  /* time one in this many calls per thread */
+#define OVERHEAD_CHECK 64   /* check the budget every this many samples */
+#define OVERHEAD_MIN 50000000 /* ns of CPU time before the budget applies */
 
 /* Parsed configuration */
 static unsigned count = 0;
 static struct entry {
     const char *name;
     double chance;
+    double lnq;                 /* log(1 - chance), see sample */
     int rate;
     int error;
+    unsigned delay;             /* milliseconds to wait before a call */
+    unsigned jitter;            /* at most this many after a call */
+    char thread[32];            /* pattern for the thread name, or "" */
+    pid_t tid;                  /* thread ID, or 0 */
+    unsigned ndests;            /* if non-zero, only trip calls to... */
+    struct dest {               /* ...one of these destinations */
+        unsigned char addr[16];
+        unsigned len, port;
+    } dests[DESTS];
+    _Atomic unsigned long calls, trips; /* see trip_stats */
 } entries[1 << 8];
 
-/* are we currently operating as a dynamic library? */
-static bool is_lib = true;
+/* Binary trie over the network destinations of all entries, so that
+ * the destination of a call can be matched against all of them in a
+ * single pass over the address.  Each node lists the entries that
+ * have a destination with the prefix leading to the node.  The nodes
+ * are allocated for the destinations of the configuration, and as
+ * rules can only be removed later on, the trie never has to grow
+ * again. */
+static unsigned nodes = 0, nterms = 0;
+static size_t capacity = 0;
+static struct node {
+    unsigned child[2];          /* 0 if there is no child */
+    int term;                   /* first terminal or -1 */
+} *trie = NULL;
+static struct term {
+    unsigned entry, port;
+    int next;
+} terms[LENGTH(entries) * DESTS];
+
+/* Addresses of the sockets with a descriptor below PEERS, so that
+ * calls on a socket only have to query its peer (or with LOCAL, its
+ * own) address once.  Each slot is a sequence lock: SEQ is odd while
+ * the slot is being written.  Calls that change or close a socket
+ * reset its slots (see ____trip_where). */
+static struct peer {
+    _Atomic unsigned seq;
+    bool valid;
+    unsigned char addr[16];
+    unsigned port;
+} peers[2][PEERS];
 
 /* random number generator data */
 static unsigned long rng[56];
@@ -75,160 +107,719 @@ static unsigned long rng[56];
 /* print debugging information to standard error */
 static bool debug_mode = false;
 
-/* list of known commands */
-#define DEF(ret, name, params, args, fail, ...)	{ #name, { __VA_ARGS__ }},
-#define E(e) { .no = e, .name = #e }
-static struct entry_name {
-    const char *const name;
-    struct {
-        int no;
-        const char *const name;
-    } errs[256/sizeof(int)-sizeof(char*)]; /* adjust if necessary */
-} names[] = {
+/* Coverage map for the exploration mode, shared between all runs that
+ * use the same file.  Each slot holds the hash of a call site that has
+ * already been tripped, or zero if the slot is free. */
+static struct covmap {
+    unsigned long magic;
+    unsigned long size;
+    _Atomic unsigned long slots[];
+} *covmap = NULL;
+
+/* Cached matches of the entries restricted to certain threads, for
+ * the current thread.  The cache of a thread is invalid if its
+ * generation differs from the global one, which changes if the rules
+ * change or a thread is renamed by another thread.  A thread that
+ * renames itself just invalidates its own cache. */
+static _Atomic unsigned generation = 1;
+static _Thread_local struct {
+    unsigned generation;
+    unsigned long match[LENGTH(entries) / 64];
+} thread_cache;
+
+/* Number of calls each entry should let pass in the current thread,
+ * plus one, or zero if a new number has to be drawn (see sample).
+ * Reset like the thread_cache.  The counters are mapped on first use
+ * and unmapped when the thread exits, so that the static TLS block
+ * only holds a pointer and the library can still be loaded using
+ * dlopen. */
+static _Thread_local struct skips {
+    unsigned generation;
+    unsigned long skip[LENGTH(entries)];
+} *skip_cache = NULL;
+static pthread_key_t skip_key;
+static pthread_once_t skip_once = PTHREAD_ONCE_INIT;
+
+/* Overhead budget (see -O), as a share of the CPU time of the
+ * process.  The time spent in the predicate is measured for one in
+ * OVERHEAD_SAMPLE calls of every thread and extrapolated.  If it
+ * exceeds the budget, we stop printing debug information and counting
+ * statistics, switch rules with a chance below SPARSE_MAX to skip
+ * counters (see sample), which only have to draw a random number once
+ * per failure, as far as each of these applies (see fall_back).  The
+ * call sites of the exploration mode always stay the same, as the
+ * coverage map could not be shared otherwise. */
+static double budget = 0;
+static _Atomic unsigned long spent = 0;     /* estimated ns, see account */
+static _Atomic unsigned long samples = 0;
+static _Atomic unsigned long cpu_base = 0;  /* CPU time at the start */
+static _Atomic unsigned fallbacks = 0;
+static unsigned long clock_cost = ULONG_MAX; /* ns to read the clock */
+static _Thread_local unsigned tick = 0;
+static _Thread_local bool slept = false;    /* a call was delayed */
+
+/* milliseconds to wait after the current call (see ____trip_late) */
+_Thread_local unsigned ____trip_jitter = 0;
+
+/* are the calls and trips of each entry counted (see trip_stats)? */
+static bool counting = true;
+
+/* rules with a lower chance use skip counters */
+static double sparse = SPARSE;
+
+/* has the configuration been parsed (see init)? */
+static atomic_bool ready = false;
+
+/* is this process in the scope of the configuration (see scope)? */
+static bool active = true;
+
+/* base address of the trip object itself, to skip our own frames */
+static void *self_base = NULL;
+
+/* stack of the current thread, to end the walk of site in time */
+static _Thread_local struct {
+    char *low, *high;
+    bool busy;                  /* being queried (see stack_bounds) */
+} stack;
+
+/* Call the next definition of FN, bypassing our own stubs */
+#define REAL(fn) ((__typeof__(fn) *) dlsym(RTLD_NEXT, #fn))
+
+/* list of known commands, sorted by name */
+#define DEF(ret, name, ...) #name,
+#define DEF_AT DEF
+#define DEF_SHORT DEF
+#define DEF_AT_SHORT DEF
+#define DEF_VA DEF
+#define DEF_ERR DEF
+#define DEF_NEW DEF
+#define DEF_AT_NEW DEF
+#define DEF_VA_NEW DEF
+static const char *const funcs[] = {
 #include "/dev/stdin"
 };
-#undef E
+#undef DEF_ERR
+#undef DEF_VA
+#undef DEF_AT_SHORT
+#undef DEF_SHORT
+#undef DEF_AT
 #undef DEF
 
-static const char *argv0;
-
 noreturn static void
 fail(const char reason[static 1], const bool print_emsg)
 {
-    dprintf(STDERR_FILENO, "%s: %s%s%s\n",
-            argv0,
+    dprintf(STDERR_FILENO, "trip: %s%s%s\n",
             reason,
             print_emsg ? ": ": "",
             print_emsg ? strerror(errno) : "");
     exit(EXIT_FAILURE);
 }
 
-/* Declare and format a string on the stack. */
-#define _$sprintf(buf, c, fmt, ...)                             \
-    for (char buf[snprintf(NULL, 0, fmt, __VA_ARGS__) + 1],     \
-             c = !'\0';                                         \
-         c != '\0' &&                                           \
-             (snprintf(buf, sizeof(buf), fmt, __VA_ARGS__), 1); \
-         c = '\0')
-#define $sprintf(buf, ...)                                      \
-    _$sprintf(buf, XGLUE(__c_, __COUNTER__), __VA_ARGS__)
+/* Helper function for bsearch */
+static int
+compar_name(const void *a, const void *b)
+{
+    return strcmp(*(const char *const *) a, *(const char *const *) b);
+}
 
-#define failf(fmt, ...)                                 \
-    do $sprintf(_, fmt, __VA_ARGS__) fail(_, false);    \
-    while (0)
+/* Check if a function is supported by trip */
+static const char* __attribute__((pure))
+check(const char *fn)
+{
+    const char *const *func =
+        bsearch(&fn, funcs, LENGTH(funcs), sizeof(*funcs), compar_name);
+    return func != NULL ? *func : NULL;
+}
+
+static unsigned long
+next(void)                          /* ... "random" number */
+{
+    static size_t i = 0;
+    unsigned long r =
+        rng[(i - 24) % LENGTH(rng)] + rng[(i - 55) % LENGTH(rng)];
+    return rng[i++ % LENGTH(rng)] = r;
+}
 
-#ifdef NDEBUG
-#define assert(_)  do { (void) 0; } while (0)
-#define debug(...) (void) 0
-#define debugf(...) (void) 0
-#else
+static double
+chance(void)
+{
+    return ((double) next()) / ((double) ULONG_MAX);
+}
 
-static void _debug(const char *words[], unsigned n);
+static void
+drop_skips(void *skips)
+{
+    munmap(skips, sizeof(struct skips));
+}
 
 static void
-do_assert(const char *val, unsigned linenr)
+make_skip_key(void)
 {
-    $sprintf(line, "(%s:%d)", __FILE__, linenr) {
-        _debug((const char*[]){"Assertion failed", val, line}, 3);
+    if (0 != pthread_key_create(&skip_key, drop_skips)) {
+        fail("pthread_key_create", false);
     }
-    abort();
 }
 
-#define assert(val)                             \
-    do {                                        \
-        if (!(val)) {                           \
-            do_assert(#val, __LINE__);          \
-        }                                       \
-    } while (0)
+/* Decide if entry I should trip the current call, by counting down
+ * the number of calls to skip before the next failure.  For a chance
+ * P this number is geometrically distributed, so that drawing it
+ * using the inverse transform method whenever the counter runs out
+ * preserves the exact probability of a failure, while most calls only
+ * have to decrement a counter. */
+static bool
+sample(unsigned i)
+{
+    if (NULL == skip_cache) {
+        int saved = errno;
+        void *mem = REAL(mmap)(NULL, sizeof(struct skips),
+                               PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (MAP_FAILED == mem) {
+            errno = saved;
+            return chance() <= entries[i].chance;
+        }
+        pthread_once(&skip_once, make_skip_key);
+        pthread_setspecific(skip_key, mem);
+        errno = saved;
+        skip_cache = mem;   /* generation zero, reset below */
+    }
 
+    unsigned gen = atomic_load_explicit(&generation, memory_order_relaxed);
+    if (skip_cache->generation != gen) {
+        memset(skip_cache->skip, 0, sizeof skip_cache->skip);
+        skip_cache->generation = gen;
+    }
+
+    unsigned long *skip = &skip_cache->skip[i];
+    if (0 == *skip) {
+        /* The uniform variate must not be zero. */
+        double u = ((double) next() + 1) / ((double) ULONG_MAX + 1);
+        double k = floor(log(u) / entries[i].lnq);
+        *skip = (0 <= k && k < (double) (ULONG_MAX - 1)
+                 ? (unsigned long) k : ULONG_MAX - 1) + 1;
+        debugf("skipping %lu calls", *skip - 1);
+    }
+
+    return 0 == --*skip;
+}
+
+/* Initialise local PRNG (Mitchell-Moore, see TAOCP p. 26).  We use a
+ * custom one so as to not interfere with rand from the standard
+ * library. */
 static void
-_debug(const char *words[], unsigned n)
+seed(void)
 {
-    typedef ssize_t (wt)(int, const void *, size_t);
-    static wt *real_write = NULL;
-    const char *const prefix = "[trip]";
+    unsigned long p = (unsigned long) (getpid() + getppid());
+    unsigned long t;
+    struct timeval tv;
+    if (0 == gettimeofday(&tv, NULL)) {
+        t = (unsigned long) (tv.tv_usec + tv.tv_sec);
+    } else {
+        t = 1;
+    }
+    rng[0] = p / t + t / p + t + p + t * p;
+    for (unsigned i = 1; i < LENGTH(rng); ++i) {
+        rng[i] = rng[i - 1] * p + t;
+    }
 
-    if (NULL == real_write) {
-        real_write = ((wt*) dlsym(RTLD_NEXT, "write"));
-        assert(NULL != real_write);
+    unsigned long n = next(); (void) n;
+    debugf("initial PRNG state is %lu", n);
+}
+
+/* Map the coverage map at PATH into memory, creating it if necessary */
+static void
+open_covmap(const char *path)
+{
+    const size_t size = sizeof(struct covmap)
+        + COVMAP_SLOTS * sizeof(unsigned long);
+    struct stat st;
+
+    int fd = REAL(open)(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (-1 == fd) {
+        $sprintf(_, "Cannot open coverage map \"%s\"", path) {
+            fail(_, true);
+        }
+    }
+    if (-1 == REAL(fstat)(fd, &st)) {
+        fail("fstat", true);
+    }
+    /* Concurrent runs may race to create the file, but they will all
+     * extend it to the same size and write the same header. */
+    if (0 == st.st_size && -1 == REAL(ftruncate)(fd, (off_t) size)) {
+        fail("ftruncate", true);
+    } else if (0 != st.st_size && size != (size_t) st.st_size) {
+        failf("\"%s\" is not a coverage map", path);
     }
 
-    real_write(STDERR_FILENO, prefix, strlen(prefix));
+    covmap = REAL(mmap)(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (MAP_FAILED == covmap) {
+        fail("mmap", true);
+    }
+    REAL(close)(fd);
+
+    if (0 == covmap->magic) {
+        covmap->size = COVMAP_SLOTS;
+        covmap->magic = COVMAP_MAGIC;
+    } else if (COVMAP_MAGIC != covmap->magic
+               || COVMAP_SLOTS != covmap->size) {
+        failf("\"%s\" is not a coverage map", path);
+    }
 
-    for (unsigned i = 0; i < n; ++i) {
-        real_write(STDERR_FILENO, " ", 1);
-        real_write(STDERR_FILENO, words[i], strlen(words[i]));
+    Dl_info info;
+    if (0 != dladdr((void *) open_covmap, &info)) {
+        self_base = info.dli_fbase;
     }
-    real_write(STDERR_FILENO, "\n", 1);
+    debug("exploring call sites using", path);
 }
 
-#define debug(...)                              \
-    do {                                        \
-        if (!debug_mode) break;                 \
-        const char *words[] = { __VA_ARGS__ };  \
-        _debug(words, LENGTH(words));           \
-    } while (0)
+/* Rebuild the trie from the destinations of all entries */
+static void
+compile(void)
+{
+    atomic_fetch_add(&generation, 1);
 
-#define debugf(fmt, ...)                        \
-    do $sprintf(_, fmt, __VA_ARGS__) debug(_);  \
-    while (0)
+    /* Every bit of a prefix adds at most one node */
+    size_t need = 1;
+    for (unsigned i = 0; i < count; ++i) {
+        for (unsigned j = 0; j < entries[i].ndests; ++j) {
+            need += entries[i].dests[j].len;
+        }
+    }
+    if (1 == need) {
+        nodes = 0;              /* see lookup */
+        return;
+    }
+    if (need > capacity) {
+        size_t size = need * sizeof(struct node);
+        void *mem = REAL(mmap)(NULL, size, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (MAP_FAILED == mem) {
+            fail("mmap", true);
+        }
+        trie = mem;
+        capacity = need;
+    }
 
-#endif
+    nodes = 1;
+    nterms = 0;
+    trie[0] = (struct node) { .term = -1 };
 
-/* Helper function for qsort and bsearch */
-static int
-compar_name(const void *a, const void *b)
+    for (unsigned i = 0; i < count; ++i) {
+        for (unsigned j = 0; j < entries[i].ndests; ++j) {
+            const struct dest *d = &entries[i].dests[j];
+            unsigned n = 0;
+
+            for (unsigned b = 0; b < d->len; ++b) {
+                unsigned bit = (d->addr[b / 8] >> (7 - b % 8)) & 1;
+                if (0 == trie[n].child[bit]) {
+                    assert(nodes < capacity);
+                    trie[nodes] = (struct node) { .term = -1 };
+                    trie[n].child[bit] = nodes++;
+                }
+                n = trie[n].child[bit];
+            }
+
+            assert(nterms < LENGTH(terms));
+            terms[nterms] = (struct term) {
+                .entry = i,
+                .port = d->port,
+                .next = trie[n].term,
+            };
+            trie[n].term = (int) nterms++;
+        }
+    }
+}
+
+/* Check if STR matches the shell-style PATTERN, that may contain the
+ * wildcards "*" and "?".  We avoid fnmatch, as it might allocate
+ * memory while we are still initialising. */
+static bool __attribute__((pure))
+wildcard(const char *pattern, const char *str)
 {
-    return strcmp((((struct entry_name *) a))->name,
-                  (((struct entry_name *) b))->name);
+    for (; '\0' != *pattern; pattern++, str++) {
+        if ('*' == *pattern) {
+            do {
+                if (wildcard(pattern + 1, str)) {
+                    return true;
+                }
+            } while ('\0' != *str++);
+            return false;
+        }
+        if ('\0' == *str || ('?' != *pattern && *pattern != *str)) {
+            return false;
+        }
+    }
+    return '\0' == *str;
 }
 
-/* Check if a function is supported by trip */
-static const char* __attribute__((pure))
-check(const char *fn)
+/* Check if entry I applies to the current thread */
+static bool
+in_thread(unsigned i)
 {
-    struct entry_name *entry =
-        bsearch(&((struct entry_name) { .name = (const char * const) fn }),
-                names,
-                LENGTH(names),
-                sizeof(struct entry_name),
-                compar_name);
-    return entry != NULL ? entry->name : NULL;
+    unsigned gen = atomic_load_explicit(&generation, memory_order_relaxed);
+
+    if (thread_cache.generation != gen) {
+        char name[16] = { 0 };
+        pid_t tid = (pid_t) syscall(SYS_gettid);
+        int saved = errno;
+
+        REAL(prctl)(PR_GET_NAME, name);
+        errno = saved;
+        debugf("matching thread %d (%s)", tid, name);
+
+        memset(thread_cache.match, 0, sizeof thread_cache.match);
+        for (unsigned j = 0; j < count; ++j) {
+            if ((0 == entries[j].tid || tid == entries[j].tid)
+                && ('\0' == entries[j].thread[0]
+                    || wildcard(entries[j].thread, name))) {
+                thread_cache.match[j / 64] |= 1UL << j % 64;
+            }
+        }
+        thread_cache.generation = gen;
+    }
+
+    return thread_cache.match[i / 64] & 1UL << i % 64;
 }
 
-static unsigned long
-next(void)                          /* ... "random" number */
+/* Intercept changes of the thread name, to invalidate cached matches
+ * (see in_thread). */
+__attribute__((visibility("default"))) int
+prctl(int option, ...)
 {
-    assert(is_lib);
-    static size_t i = 0;
-    unsigned long r =
-        rng[(i - 24) % LENGTH(rng)] + rng[(i - 55) % LENGTH(rng)];
-    return rng[i++ % LENGTH(rng)] = r;
+    static int (*real)(int, ...) = NULL;
+    unsigned long arg[4];
+    va_list ap;
+
+    va_start(ap, option);
+    for (unsigned i = 0; i < LENGTH(arg); ++i) {
+        arg[i] = va_arg(ap, unsigned long);
+    }
+    va_end(ap);
+
+    if (NULL == real) {
+        real = REAL(prctl);
+    }
+    int ret = real(option, arg[0], arg[1], arg[2], arg[3]);
+    if (PR_SET_NAME == option) {
+        thread_cache.generation = 0;
+    }
+    return ret;
 }
 
-static double
-chance(void)
+__attribute__((visibility("default"))) int
+pthread_setname_np(pthread_t thread, const char *name)
 {
-    assert(is_lib);
-    return ((double) next()) / ((double) ULONG_MAX);
+    static __typeof__(pthread_setname_np) *real = NULL;
+
+    if (NULL == real) {
+        real = REAL(pthread_setname_np);
+    }
+    int ret = real(thread, name);
+    if (pthread_equal(thread, pthread_self())) {
+        thread_cache.generation = 0;
+    } else {
+        atomic_fetch_add(&generation, 1);
+    }
+    return ret;
 }
 
-/* Function to parse the configuration */
+/* Convert the socket address SA of LEN bytes into an IPv6 address
+ * ADDR (see parse_dest) and a PORT. */
+static bool
+convert(const struct sockaddr *sa, socklen_t len,
+        unsigned char addr[static 16], unsigned *port)
+{
+    switch (sa->sa_family) {
+    case AF_INET: {
+        const struct sockaddr_in *in = (const struct sockaddr_in *) sa;
+        if (len < sizeof *in) {
+            return false;
+        }
+        memset(addr, 0, 10);
+        addr[10] = addr[11] = 0xff;
+        memcpy(addr + 12, &in->sin_addr, 4);
+        *port = ntohs(in->sin_port);
+        return true;
+    }
+    case AF_INET6: {
+        const struct sockaddr_in6 *in6 = (const struct sockaddr_in6 *) sa;
+        if (len < sizeof *in6) {
+            return false;
+        }
+        memcpy(addr, &in6->sin6_addr, 16);
+        *port = ntohs(in6->sin6_port);
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+/* Copy the cached address of slot P into ADDR and PORT, if it is valid
+ * and not being modified concurrently. */
+static bool
+recall(struct peer *p, unsigned char addr[static 16], unsigned *port)
+{
+    unsigned seq = atomic_load_explicit(&p->seq, memory_order_acquire);
+    if (seq % 2 || !p->valid) {
+        return false;
+    }
+    memcpy(addr, p->addr, 16);
+    *port = p->port;
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&p->seq, memory_order_relaxed) == seq;
+}
+
+/* Store ADDR and PORT in slot P, unless another thread is already
+ * writing to it. */
 static void
-init(void)
+remember(struct peer *p, const unsigned char addr[static 16], unsigned port)
+{
+    unsigned seq = atomic_load_explicit(&p->seq, memory_order_relaxed);
+    if (seq % 2 || !atomic_compare_exchange_strong(&p->seq, &seq, seq + 1)) {
+        return;
+    }
+    memcpy(p->addr, addr, 16);
+    p->port = port;
+    p->valid = true;
+    atomic_store_explicit(&p->seq, seq + 2, memory_order_release);
+}
+
+/* Invalidate the cached addresses of the socket FD */
+static void
+forget(int fd)
+{
+    if (0 > fd || fd >= PEERS) {
+        return;
+    }
+    for (unsigned i = 0; i < LENGTH(peers); ++i) {
+        struct peer *p = &peers[i][fd];
+        unsigned seq;
+
+        do {
+            seq = atomic_load_explicit(&p->seq, memory_order_relaxed) & ~1U;
+        } while (!atomic_compare_exchange_weak(&p->seq, &seq, seq + 1));
+        p->valid = false;
+        atomic_store_explicit(&p->seq, seq + 2, memory_order_release);
+    }
+}
+
+/* Called by the trip stubs with descriptors returned by calls, which
+ * might reuse the number of a socket that was closed in a way we did
+ * not see, e.g. by fclose or an internal close of the C library. */
+void
+____trip_renew(int fd)
+{
+    if (0 < nodes) {
+        forget(fd);
+    }
+}
+
+/* Set a bit in MATCH for every entry with a destination matching the
+ * address that WHERE is directed at. */
+static void
+lookup(const struct ____trip_where *where, unsigned long match[])
+{
+    unsigned char addr[16];
+    unsigned port;
+
+    if (0 == nodes) {
+        return;                 /* nothing to match against */
+    }
+    if (NULL != where->addr) {
+        if (!convert(where->addr, where->addrlen, addr, &port)) {
+            return;
+        }
+    } else {
+        struct peer *p = 0 <= where->fd && where->fd < PEERS
+            ? &peers[where->local][where->fd] : NULL;
+
+        if (-1 == where->fd) {
+            return;
+        }
+        if (NULL == p || !recall(p, addr, &port)) {
+            struct sockaddr_storage ss;
+            socklen_t len = sizeof ss;
+            int saved = errno, ret;
+
+            ret = where->local ? getsockname(where->fd, (struct sockaddr *) &ss, &len)
+                : getpeername(where->fd, (struct sockaddr *) &ss, &len);
+            errno = saved;
+            if (-1 == ret || !convert((struct sockaddr *) &ss, len, addr, &port)) {
+                return;
+            }
+            /* An unconnected socket might still be connected later,
+             * so only successful queries are cached. */
+            if (NULL != p) {
+                remember(p, addr, port);
+            }
+        }
+    }
+
+    for (unsigned n = 0, b = 0; ; ++b) {
+        for (int t = trie[n].term; -1 != t; t = terms[t].next) {
+            if (0 == terms[t].port || port == terms[t].port) {
+                match[terms[t].entry / 64] |= 1UL << terms[t].entry % 64;
+            }
+        }
+        if (128 == b || 0 == (n = trie[n].child[(addr[b / 8] >> (7 - b % 8)) & 1])) {
+            break;
+        }
+    }
+}
+
+/* Remove the preload library from LD_PRELOAD, so that trip is not
+ * loaded into any process this one executes. */
+static void
+unload(void)
 {
-    assert (is_lib);
+    extern char **environ;
+    Dl_info info;
+
+    if (0 == dladdr((void *) unload, &info)) {
+        return;
+    }
+    const char *self = strrchr(info.dli_fname, '/');
+    self = self ? self + 1 : info.dli_fname;
+
+    for (char **env = environ; NULL != *env; ++env) {
+        if (strncmp(*env, "LD_PRELOAD=", 11)) {
+            continue;
+        }
+
+        /* The list can only become shorter, so we can rewrite it in
+         * place. */
+        char *r = *env + 11, *w = r;
+        while ('\0' != *r) {
+            size_t n = strcspn(r, ": ");
+            const char *base = r + n;
+            while (base > r && '/' != base[-1]) {
+                base--;
+            }
+            if (strlen(self) != (size_t) (r + n - base)
+                || strncmp(base, self, (size_t) (r + n - base))) {
+                if (w != *env + 11) {
+                    *w++ = ':';
+                }
+                memmove(w, r, n);
+                w += n;
+            }
+            r += n + strspn(r + n, ": ");
+        }
+        *w = '\0';
+        debug("preloading", *env);
+    }
+}
+
+/* Decide if this process is in the scope of the configuration, using
+ * the option NAME with the value ARG.  "-o" restricts trip to programs
+ * whose name or path match a pattern, and "-n" to programs that were
+ * executed by at most a number of exec(3) calls since the launcher.
+ * The latter option is followed by the depth of the parent process as
+ * a fixed-length hexadecimal number, that is updated in the
+ * environment ENV of the process for its children. */
+static void
+scope(const char *name, const char *arg, char *env)
+{
+    if (!strcmp(name, "-o")) {
+        char exe[PATH_MAX] = { 0 };
+        REAL(readlink)("/proc/self/exe", exe, sizeof exe - 1);
+        const char *base = strrchr(exe, '/');
+        base = base ? base + 1 : exe;
+
+        if (NULL != strchr(arg, '/') ? !wildcard(arg, exe)
+            : !wildcard(arg, base) && !wildcard(arg, program_invocation_short_name)) {
+            debug("out of scope:", exe);
+            active = false;
+        }
+    } else {
+        char *end;
+        unsigned long max = strtoul(arg, &end, 10);
+        if (':' != *end) {
+            failf("Malformed exec depth \"%s\"", arg);
+        }
+        unsigned long depth = strtoul(end + 1, NULL, 16) + 1;
 
+        char *digits = env + (end + 1 - arg);
+        size_t n = strspn(digits, "0123456789abcdef");
+        if (depth < 1UL << (4 * n)) {
+            for (size_t i = 0; i < n; ++i) {
+                digits[n - i - 1] = "0123456789abcdef"[(depth >> (4 * i)) & 0xf];
+            }
+        }
+
+        if (depth > max) {
+            debugf("out of scope at exec depth %lu", depth);
+            active = false;
+            unload();
+        }
+    }
+}
+
+/* Read the clock CLOCK in nanoseconds */
+static unsigned long
+nsec(clockid_t clock)
+{
+    struct timespec ts;
+    if (0 != clock_gettime(clock, &ts)) {
+        return 0;
+    }
+    return (unsigned long) ts.tv_sec * 1000000000UL + (unsigned long) ts.tv_nsec;
+}
+
+/* Handle a global option NAME with the value ARG, that was copied
+ * from ENV in the environment. */
+static void
+option(const char *name, const char *arg, char *env)
+{
+    if (NULL == arg) {
+        failf("Missing argument for option \"%s\"", name);
+    }
+
+    if (!strcmp(name, "-m")) {
+        open_covmap(arg);
+    } else if (!strcmp(name, "-o") || !strcmp(name, "-n")) {
+        scope(name, arg, env);
+    } else if (!strcmp(name, "-O")) {
+        char *end;
+        budget = strtod(arg, &end) / 100;
+        if ('\0' != *end || !(0 < budget && budget <= 1)) {
+            failf("Malformed overhead budget \"%s\"", arg);
+        }
+        for (unsigned i = 0; i < 32; ++i) {
+            unsigned long t = nsec(CLOCK_MONOTONIC);
+            t = nsec(CLOCK_MONOTONIC) - t;
+            if (t < clock_cost) {
+                clock_cost = t;
+            }
+        }
+        atomic_store(&cpu_base, nsec(CLOCK_PROCESS_CPUTIME_ID));
+    } else {
+        debug("unknown option", name);
+    }
+}
+
+/* Function to parse the configuration.  It is run when the library is
+ * loaded, or before that if a stub is called by an earlier
+ * constructor. */
+static void __attribute__((constructor))
+init(void)
+{
     static atomic_flag done = ATOMIC_FLAG_INIT;
-    static volatile bool ready = false;
+
+    if (atomic_load_explicit(&ready, memory_order_acquire)) {
+        return;
+    }
     if (true == atomic_flag_test_and_set(&done)) {
-        while (!ready);
+        while (!atomic_load_explicit(&ready, memory_order_acquire));
         return;			/* prevent concurrent re-initialisation */
     }
 
-    const char *conf = getenv(ENVCONFNAME);
+    char *conf = getenv(ENVCONFNAME);
     if (NULL == conf) {		/* no configuration, no cry */
-        ready = !ready;
+        /* Rules might still be added using the library interface. */
+        seed();
+        atomic_store_explicit(&ready, true, memory_order_release);
         return;
     }
 
@@ -252,6 +843,19 @@ init(void)
         *e = (struct entry) { .name = strtok_r(tok, GS, &s2) };
         assert(NULL != e->name); /* otherwise we wouldn't be here */
 
+        if ('-' == e->name[0]) { /* global option, not a function */
+            char *arg = strtok_r(NULL, GS, &s2);
+            /* Out of scope, we still have to count the exec depth for
+             * the children of this process. */
+            if (active || !strcmp(e->name, "-n")) {
+                option(e->name, arg, arg ? conf + (arg - copy) : NULL);
+            }
+            continue;
+        }
+        if (!active) {
+            break;              /* skip all rules */
+        }
+
         const char *const dup = check(e->name);
         if (dup == NULL) {
             debug("unknown function", e->name);
@@ -273,6 +877,7 @@ init(void)
                 fail(_, errno != 0);
             }
         }
+        e->lnq = log1p(-e->chance);
 
         char *code = strtok_r(NULL, GS, &s2);
         if (NULL == code) {
@@ -285,414 +890,553 @@ init(void)
             failf("Malformed trip error code \"%s\"", code);
         }
 
+        /* Any remaining fields are qualifiers (see main.c:/qualifier/) */
+        char *qual;
+        while (NULL != (qual = strtok_r(NULL, GS, &s2))) {
+            if ('[' == qual[0] || isdigit((unsigned char) qual[0])) {
+                struct dest *d = &e->dests[e->ndests];
+                if (e->ndests >= DESTS) {
+                    failf("Too many destinations for %s", e->name);
+                }
+                if (!parse_dest(qual, d->addr, &d->len, &d->port)) {
+                    failf("Malformed destination \"%s\"", qual);
+                }
+                e->ndests++;
+            } else if (!strncmp(qual, "delay=", 6)) {
+                e->delay = (unsigned) strtoul(qual + 6, NULL, 10);
+            } else if (!strncmp(qual, "jitter=", 7)) {
+                e->jitter = (unsigned) strtoul(qual + 7, NULL, 10);
+            } else if (!strncmp(qual, "thread=", 7)) {
+                if (strlen(qual + 7) >= sizeof e->thread) {
+                    failf("Overlong thread pattern \"%s\"", qual + 7);
+                }
+                strcpy(e->thread, qual + 7);
+            } else if (!strncmp(qual, "tid=", 4)) {
+                e->tid = (pid_t) strtol(qual + 4, NULL, 10);
+            } else {
+                debug("unknown qualifier", qual);
+            }
+        }
+
         count++;
     }
-    assert(count > 0);
+    assert(count > 0 || NULL != covmap || !active);
 
-    /* Initialise local PRNG (Mitchell-Moore, see TAOCP p. 26).  We use a
-     * custom one so as to not interfere with rand from the standard
-     * library. */
-    unsigned long p = (unsigned long) (getpid() + getppid());
-    unsigned long t;
-    struct timeval tv;
-    if (0 == gettimeofday(&tv, NULL)) {
-        t = (unsigned long) (tv.tv_usec + tv.tv_sec);
-    } else {
-        t = 1;
-    }
-    rng[0] = p / t + t / p + t + p + t * p;
-    for (unsigned i = 1; i < LENGTH(rng); ++i) {
-        rng[i] = rng[i - 1] * p + t;
-    }
+    compile();
 
-    unsigned long n = next(); (void) n;
-    debugf("initial PRNG state is %lu", n);
+    seed();
 
     debug("initialised");
-    ready = !ready;             /* spin-un-lock */
+    atomic_store_explicit(&ready, true, memory_order_release); /* spin-un-lock */
 }
 
-/* Failure predicate called by the trip stubs. */
-bool
-____trip_should_fail(const char *name, const int *errv, size_t errn)
+/* Find the bounds of the stack of the current thread, once, for site.
+ * pthread_getattr_np might allocate memory and thereby call one of
+ * our stubs, which must not try to walk the stack in turn. */
+static bool
+stack_bounds(void)
 {
-    if (!is_lib) return false;
-
-    /* Initialise failure data if necessary */
-    init();
-
-    /* FIXME: Replace the associative array with something that has less
-     * of an overhead. */
-    debug("intercepting", name);
-    for (unsigned i = 0; i < count; ++i) {
-        if (!!strcmp(name, entries[i].name)) {
-            continue;
-        }
+    pthread_attr_t attr;
+    void *addr;
+    size_t size;
 
-        debug("probing", name);
-        if (chance() > entries[i].chance) {
-            /* FIXME: If we have multiple entries on the same function,
-             * their chances should be properly aggregated.  Currently, if
-             * the first entry has a chance of P and the second one has a
-             * chance of Q, the actual chance of the second entry will
-             * turn out to be (1-P) * Q. */
-            continue;
-        }
-
-        /* Update errno with either a random or the requested error *
-         * value. */
-        errno = entries[i].error == 0 && errn > 0 ? errv[next() % errn]
-            : entries[i].error;
-
-        debug("tripping", name);
+    if (NULL != stack.low) {
         return true;
     }
+    if (stack.busy) {
+        return false;
+    }
 
-    debug("forgiving", name);
-
-    return false;
+    stack.busy = true;
+    int saved = errno;
+    bool ok = 0 == pthread_getattr_np(pthread_self(), &attr);
+    if (ok) {
+        ok = 0 == pthread_attr_getstack(&attr, &addr, &size);
+        pthread_attr_destroy(&attr);
+    }
+    if (ok) {
+        stack.low = addr;
+        stack.high = (char *) addr + size;
+    }
+    errno = saved;
+    stack.busy = false;
+    return ok;
 }
 
-/* Parse and add an ENTRY to the table entries. */
-static void
-enter(char *entry)
+/* Hash the call site that invoked a trip stub.  We walk the frame
+ * pointer chain, skipping all frames inside of trip itself, and
+ * combine the first SITE_DEPTH return addresses relative to the base
+ * address of the object they belong to, so that the hash remains
+ * stable between runs despite address space layout randomisation.
+ * Frames without a frame pointer end the walk early, or at the latest
+ * at the bounds of the stack.  If these are unknown, zero is returned
+ * and the call should not be tripped. */
+static unsigned long __attribute__((noinline))
+site(void)
 {
-    assert(!is_lib);
+    unsigned long hash = 14695981039346656037UL; /* FNV-1a */
+    void **fp = __builtin_frame_address(0);
 
-    char *func, *chance, *error;
-    func = strtok(entry, DELIM);
-    if (!func) {
-        fail("Must pass a non-empty function name\n", false);
-    }
-    if (check(func) == NULL) {
-        failf("Unknown function \"%s\", cannot trip", func);
+    if (!stack_bounds()) {
+        return 0;
     }
+    for (unsigned depth = 0; depth < SITE_DEPTH && NULL != fp; ) {
+        if ((char *) fp < stack.low || (char *) (fp + 2) > stack.high) {
+            break;
+        }
 
-    chance = strtok(NULL, DELIM);
-    if (NULL == chance) {
-        error = NULL;
-        goto skip;
-    }
-    error = strtok(NULL, DELIM);
+        void **up = fp[0];
+        Dl_info info;
 
-    if (NULL == error && NULL != chance && (tolower(chance[0]) == 'e')) {
-        error = chance;
-        chance = NULL;
+        if (NULL == fp[1] || 0 == dladdr(fp[1], &info)) {
+            break;
+        }
+        if (info.dli_fbase != self_base) {
+            const char *base = strrchr(info.dli_fname, '/');
+            base = base ? base + 1 : info.dli_fname;
+            for (; *base; base++) {
+                hash = (hash ^ (unsigned char) *base) * 1099511628211UL;
+            }
+            hash = (hash ^ (unsigned long)
+                    ((char *) fp[1] - (char *) info.dli_fbase))
+                * 1099511628211UL;
+            depth++;
+        }
+
+        /* Stacks grow downwards, anything else is not a frame. */
+        if (up <= fp || (char *) up - (char *) fp > 1 << 20) {
+            break;
+        }
+        fp = up;
     }
 
-  skip:
-    entries[count] = (struct entry) { .name = func };
+    return 0 != hash ? hash : 1; /* zero marks a free slot */
+}
+
+/* Check if the call site with the hash SITE has never been tripped
+ * before, and record it in the coverage map.  Only COVMAP_PROBE slots
+ * are inspected, so that a (nearly) full map does not slow down every
+ * call; sites that do not fit are regarded as seen. */
+static bool
+unseen(unsigned long site)
+{
+    assert(NULL != covmap);
 
-    char *end;
-    errno = 0;
-    double num = 1;
-    if (NULL != chance) {
-        num = strtod(chance, &end);
-        if (*end != '\0' || (num == 0 && errno != 0)) {
-            failf("Cannot parse chance \"%s\"", chance);
+    for (unsigned long i = 0; i < COVMAP_PROBE; ++i) {
+        _Atomic unsigned long *slot = &covmap->slots[(site + i) % covmap->size];
+        unsigned long old = atomic_load_explicit(slot, memory_order_relaxed);
+
+        if (0 == old && atomic_compare_exchange_strong(slot, &old, site)) {
+            return true;
+        }
+        if (old == site) {
+            return false;
         }
     }
 
-    if (0 >= num) {
-        failf("The chance %s (for %s) is not positive", chance,
-              func);
-    }
-    if (1 >= num) {
-        entries[count].chance = num;
-    } else {
-        failf("The chance %g (for %s) is greater than 1", num,
-              func);
-    }
+    debug("coverage map is full");
+    return false;
+}
 
-    if (NULL != error) {
-        for (unsigned i = 0; i < strlen(error); ++i) {
-            error[i] = (char) toupper((unsigned char) error[i]);
+/* Check if any rule would switch to skip counters with SPARSE_MAX */
+static bool
+any_sparse(void)
+{
+    for (unsigned i = 0; i < count; ++i) {
+        if (SPARSE <= entries[i].chance && entries[i].chance < SPARSE_MAX) {
+            return true;
         }
-        for (unsigned i = 0; i < LENGTH(names); ++i) {
-            if (!strcmp(names[i].name, func)) {
-                for (unsigned j = 0; j < LENGTH(names[i].errs); ++j) {
-                    if (!strcmp(names[i].errs[j].name, error)) {
-                        entries[count].error = names[i].errs[j].no;
-                        goto found_it;
-                    }
-                }
-                break;
+    }
+    return false;
+}
+
+/* Switch to the next cheaper mode, after the estimated overhead EST
+ * exceeded the budget in CPU nanoseconds of the process.  Modes that
+ * would not change anything are passed over. */
+static void
+fall_back(unsigned long est, unsigned long cpu)
+{
+    const double limit = budget;
+    const char *what = NULL;
+
+    while (NULL == what) {
+        switch (atomic_fetch_add(&fallbacks, 1)) {
+        case 0:
+            if (debug_mode || counting) {
+                debug_mode = false;
+                counting = false;
+                what = "disabling debug output and statistics";
             }
+            break;
+        case 1:
+            if (any_sparse()) {
+                sparse = SPARSE_MAX;
+                what = "switching rules with a low chance to skip counters";
+            }
+            break;
+        case 2:
+            budget = 0;         /* stop measuring */
+            what = "but there is no cheaper mode left";
+            break;
+        default:
+            return;
         }
-        failf("%s is not expected to return %s", func, error);
-
-      found_it:
-        ;
     }
 
-    count++;
+    dprintf(STDERR_FILENO,
+            "trip: overhead of %.2f%% after %.3fs of CPU time exceeds "
+            "the budget of %g%%, %s\n",
+            100.0 * (double) est / (double) cpu, (double) cpu / 1e9,
+            100 * limit, what);
+
+    /* Measure the new mode from scratch */
+    atomic_store(&spent, 0);
+    atomic_store(&cpu_base, nsec(CLOCK_PROCESS_CPUTIME_ID));
 }
 
-/* List all supported functions */
-noreturn static void
-list(const char *unused)
+/* Add the time T of a sampled call to the estimated overhead, and
+ * compare it with the CPU time of the process every now and then.
+ * Reading the clock only costs us once per sample. */
+static void
+account(unsigned long t)
 {
-    (void) unused;
-    assert(!is_lib);
+    unsigned long est = (t > clock_cost ? t - clock_cost : 0) * OVERHEAD_SAMPLE
+        + clock_cost;
+    est += atomic_fetch_add_explicit(&spent, est, memory_order_relaxed);
+    if (0 != atomic_fetch_add_explicit(&samples, 1, memory_order_relaxed)
+        % OVERHEAD_CHECK) {
+        return;
+    }
 
-    for (unsigned i = 0; i < LENGTH(names); ++i) {
-        puts(names[i].name);
+    int saved = errno;
+    unsigned long cpu = nsec(CLOCK_PROCESS_CPUTIME_ID) - atomic_load(&cpu_base);
+    if (OVERHEAD_MIN <= cpu && (double) est > budget * (double) cpu) {
+        fall_back(est, cpu);
     }
-    exit(EXIT_SUCCESS);
+    errno = saved;
 }
 
-/* List all supported errno values for func. */
-noreturn static void
-list_errors(const char *func)
+/* Sleep for MS milliseconds, without clobbering errno */
+static void
+pause_ms(unsigned ms)
+{
+    struct timespec ts = {
+        .tv_sec = ms / 1000,
+        .tv_nsec = (long) (ms % 1000) * 1000000,
+    };
+    int saved = errno;
+    nanosleep(&ts, NULL);
+    errno = saved;
+}
+
+/* Called by the trip stubs after the real call returned, to wait for
+ * the MS milliseconds of jitter chosen by the predicate.  Delaying the return instead of
+ * the call makes timed waits such as pthread_cond_timedwait return
+ * after their deadline, which sleeping before a wait until an absolute
+ * time cannot do. */
+void
+____trip_late(unsigned ms)
 {
-    if (check(func) == NULL) {
-        failf("Unknown function \"%s\"", func);
+    pause_ms(ms);
+}
+
+static bool predicate(const char *name, const struct ____trip_where *where,
+                      size_t *part, const int *errv, size_t errn);
+
+/* Failure predicate called by the trip stubs, for calls with a network
+ * destination WHERE (or NULL), and with a count PART that may be
+ * shortened (see ____TRIP_SHORT). */
+bool
+____trip_should_fail_at(const char *name, const struct ____trip_where *where,
+                        size_t *part, const int *errv, size_t errn)
+{
+    /* Initialise failure data if necessary.  Checking the flag first
+     * avoids the atomic read-modify-write in init on every call. */
+    if (!atomic_load_explicit(&ready, memory_order_acquire)) {
+        init();
+    }
+    if (!active) {
+        return false;
     }
 
-    for (unsigned i = 0; i < LENGTH(names); ++i) {
-        if (!strcmp(names[i].name, func)) {
-            for (unsigned j = 0; names[i].errs[j].no != 0; ++j) {
-                puts(names[i].errs[j].name);
-            }
-            exit(EXIT_SUCCESS);
+    bool trip;
+    if (0 == budget || 0 != tick++ % OVERHEAD_SAMPLE) {
+        trip = predicate(name, where, part, errv, errn);
+    } else {
+        slept = false;
+        unsigned long t = nsec(CLOCK_MONOTONIC);
+        trip = predicate(name, where, part, errv, errn);
+        t = nsec(CLOCK_MONOTONIC) - t;
+        if (!slept) {           /* delays are not an overhead */
+            account(t);
         }
     }
 
-    abort();
+    /* Calls that are not made are not late either */
+    if (trip) {
+        ____trip_jitter = 0;
+    }
+
+    /* The addresses of the socket are only forgotten after the
+     * predicate, which might still need them for "close". */
+    if (NULL != where && where->reset && 0 < nodes) {
+        forget(where->fd);
+    }
+    return trip;
 }
 
-/* print a list of all functions that trip could affect */
-noreturn static void
-check_exec(const char *exec)
+static bool
+predicate(const char *name, const struct ____trip_where *where,
+          size_t *part, const int *errv, size_t errn)
 {
-    FILE *nm;
-    char line[BUFSIZ], *PATH, *dir = NULL, *func;
-    int status, fd;
+    unsigned long match[LENGTH(entries) / 64];
+    bool matched = false;
 
-    PATH = getenv("PATH");
-    if (NULL == PATH) {
-        fail("no $PATH set", false);
-    }
+    /* FIXME: Replace the associative array with something that has less
+     * of an overhead. */
+    debug("intercepting", name);
+    for (unsigned i = 0; i < count; ++i) {
+        if (!!strcmp(name, entries[i].name)) {
+            continue;
+        }
 
-    $sprintf(path_cpy, ".:%s", PATH) {
-        nm = NULL;
-        while ((dir = strtok(dir == NULL ? path_cpy : NULL, ":"))) {
-            debugf("looking for %s in '%s'...", exec, dir);
-            fd = open(dir, O_DIRECTORY);
-            if (-1 == fd) { continue; } /* invalid component */
+        if (('\0' != entries[i].thread[0] || 0 != entries[i].tid)
+            && !in_thread(i)) {
+            continue;
+        }
 
-            if (0 == faccessat(fd, exec, X_OK, AT_EACCESS)) {
-                debugf("found %s in '%s'", exec, dir);
-                close(fd);
+        if (0 < entries[i].ndests) {
+            if (NULL == where) {
+                continue;
+            }
+            if (!matched) {
+                memset(match, 0, sizeof match);
+                lookup(where, match);
+                matched = true;
+            }
+            if (!(match[i / 64] & 1UL << i % 64)) {
+                continue;
+            }
+        }
 
-                assert(NULL != dir);
-                $sprintf(cmd, "nm -uP '%s/%s'", dir, exec) {
-                    debugf("executing \"%s\"", cmd);
-                    nm = popen(cmd, "r");
-                }
-                if (NULL == nm) {
-                    fail("popen", true);
-                }
-                break;
+        debug("probing", name);
+        if (counting) {
+            atomic_fetch_add_explicit(&entries[i].calls, 1, memory_order_relaxed);
+        }
+        if (0 < entries[i].delay) {
+            pause_ms(entries[i].delay);
+            slept = true;
+        }
+        if (0 < entries[i].jitter) {
+            ____trip_jitter += (unsigned) (next() % (entries[i].jitter + 1UL));
+        }
+        /* Counts that cannot be reduced any further (or that were
+         * negative before being converted) are left as they are.  This
+         * has to be known before a call site is claimed, so that it is
+         * only regarded as covered when it was actually tripped. */
+        if (____TRIP_SHORT == entries[i].error
+            && (NULL == part || *part <= 1 || *part > SSIZE_MAX)) {
+            continue;
+        }
+        if (NULL != covmap) {
+            /* In the exploration mode, we trip every call site exactly
+             * once, ignoring the chance. */
+            unsigned long h = site();
+            debugf("call site %016lx", h);
+            if (0 == h || !unseen(h)) {
+                continue;
             }
-            close(fd);
+        } else if (entries[i].chance < sparse
+                   ? !sample(i)
+                   : chance() > entries[i].chance) {
+            /* FIXME: If we have multiple entries on the same function,
+             * their chances should be properly aggregated.  Currently, if
+             * the first entry has a chance of P and the second one has a
+             * chance of Q, the actual chance of the second entry will
+             * turn out to be (1-P) * Q. */
+            continue;
         }
-        if (dir == NULL) {
-            failf("failed to locate %s in $PATH", exec);
+
+        /* Update errno with either a random or the requested error *
+         * value.  SHORT is always listed last and only applies when it
+         * was asked for explicitly, never as a random error. */
+        size_t real = errn;
+        if (0 < real && ____TRIP_SHORT == errv[real - 1]) {
+            real--;
         }
-    }
-    assert(nm != NULL);
+        int error = entries[i].error == 0 && real > 0 ? errv[next() % real]
+            : entries[i].error;
 
-    while (NULL != fgets(line, sizeof line, nm)) {
-        func = strtok(line, " @");
-        if (func == NULL || check(func) == NULL) {
-            continue;
+        if (____TRIP_SHORT == error) {
+            *part = 1 + next() % (*part - 1);
+            if (counting) {
+                atomic_fetch_add_explicit(&entries[i].trips, 1, memory_order_relaxed);
+            }
+            debugf("shortening %s to %zu", name, *part);
+            return false;
         }
+        errno = error;
 
-        puts(func);
-    }
-    if (ferror(nm)) {
-        fail("fgets", true);
+        if (counting) {
+            atomic_fetch_add_explicit(&entries[i].trips, 1, memory_order_relaxed);
+        }
+        debug("tripping", name);
+        return true;
     }
 
-    status = pclose(nm);
-    if (-1 == status) {
-        fail("pclose", true);
+    debug("forgiving", name);
+
+    return false;
+}
+
+/* Library interface, see libtrip.h.  The rules share the table that
+ * is filled from the configuration, so that they take effect
+ * immediately.  Modifying rules is not synchronised with concurrent
+ * calls of tripped functions. */
+
+/* Remove all entries for NAME, without recompiling the trie */
+static void
+drop(const char *name)
+{
+    unsigned j = 0;
+    for (unsigned i = 0; i < count; ++i) {
+        if (name != entries[i].name) {
+            entries[j++] = entries[i];
+        }
     }
-    if (!WIFEXITED(status)) {
-        fail("nm failed to terminate normally", false);
+    count = j;
+}
+
+int
+trip_set(const char *func, double chance, int error)
+{
+    init();
+
+    const char *name = check(func);
+    if (NULL == name) {
+        errno = ENOENT;
+        return -1;
     }
-    if (0 != WEXITSTATUS(status)) {
-        failf("nm failed with status %d", WEXITSTATUS(status));
+    if (!(0 <= chance && chance <= 1) || 0 > error) {
+        errno = EINVAL;
+        return -1;
     }
 
-    exit(EXIT_SUCCESS);
+    /* All qualifiers of the previous rules are dropped with them */
+    drop(name);
+    if (count >= LENGTH(entries)) { /* nothing was dropped */
+        errno = ENOSPC;
+        return -1;
+    }
+    entries[count++] = (struct entry) {
+        .name = name,
+        .chance = chance,
+        .lnq = log1p(-chance),
+        .error = error,
+    };
+    compile();
+    debug("setting", name);
+    return 0;
 }
 
-noreturn static void
-version(const char *unused)
+int
+trip_unset(const char *func)
 {
-    (void) unused;
-    dprintf(STDOUT_FILENO,
-            "version \t" VERSION "\n"
-            "compiler\t" COMPILER "\n"
-            "built   \t" __DATE__ ", " __TIME__ "\n") ;
-    exit(EXIT_SUCCESS);
-}
+    init();
 
-/* Print a usage string and terminate */
-noreturn static void
-usage(const char *argv0)
-{
-    assert(!is_lib);
+    const char *name = check(func);
+    if (NULL == name) {
+        errno = ENOENT;
+        return -1;
+    }
 
-    dprintf(STDERR_FILENO, USAGE, argv0);
-    dprintf(STDERR_FILENO, "Flags:\n"
-            "\t-l\tList all supported functions\n"
-            "\t-e FUNC\tList all errno values for FUNC\n"
-            "\t-c EXEC\tList all tripable functions in EXEC\n"
-#ifndef NDEBUG
-            "\t-d\tPrint debugging information\n"
-#endif
-            "\t-V\tPrint version and build information\n"
-            "\t-h\tPrint this message\n");
-    exit(EXIT_SUCCESS);
+    drop(name);
+    compile();
+    debug("unsetting", name);
+    return 0;
 }
 
-int __attribute__((weak))
-main(int argc, char *argv[])
+void
+trip_clear(void)
 {
-    _Static_assert(0 < LENGTH(names), "The names array is empty");
+    init();
 
-    argv0 = argv[0];
-    is_lib = false;
+    count = 0;
+    compile();
+    debug("clearing all rules");
+}
 
-    /* If the environmental variable is set, we are currently being
-     * invoked instead of the actual main function.  As this is not
-     * intended, we abort execution immediately. */
-    char *conf = getenv(ENVCONFNAME);
-    if (conf) {
-        dprintf(STDERR_FILENO, "Don't trip me\n");
-        exit(EXIT_FAILURE);
-    }
-
-    struct option {
-        void (*fn)(const char *); char *arg;
-    } options[1 << CHAR_BIT] = {
-    ['l'] = { list,          NULL    },
-    ['e'] = { list_errors,   NULL    },
-    ['c'] = { check_exec,    NULL    },
-    ['V'] = { version,       NULL    },
-    ['h'] = { usage,         argv[0] },
-    };
-    struct option *choice = NULL;
-
-    /* Otherwise we are being invoked to wrap an actual call.  Let us *
-     * start by parsing the command line. */
-    int opt;
-    while ((opt = getopt(argc, argv, "dle:c:Vh")) != -1) {
-        switch (opt) {
-        case 'd':
-#ifndef NDEBUG
-            debug_mode = true;
-#else
-            fail("trip not build with debugging option", false);
-#endif
-            break;
-        default:
-            if (NULL == options[opt].fn) {
-                exit(EXIT_FAILURE); /* "invalid option" */
-            }
-            if (NULL != choice) {
-                fail("contradictory flags", false);
-            }
+int
+trip_stats(const char *func, struct trip_count *stats)
+{
+    init();
 
-            choice = &options[opt];
-            if (choice->arg == NULL) {
-                choice->arg = optarg;
-            }
-        }
+    const char *name = NULL;
+    if (NULL != func && NULL == (name = check(func))) {
+        errno = ENOENT;
+        return -1;
     }
-    if (choice != NULL) {
-        /* if we have selected a specific mode of operation, the
-         * remaining flags will be ignored.  To avoid accidentally
-         * passing too many arguments that are then silently ignored,
-         * we instead remind the user of how to use Trip. */
-        if (optind < argc) {
-            usage(argv[0]);
-        }
 
-        assert(NULL != choice->fn);
-        choice->fn(choice->arg);
+    *stats = (struct trip_count) { 0 };
+    for (unsigned i = 0; i < count; ++i) {
+        if (NULL == name || name == entries[i].name) {
+            stats->calls += atomic_load_explicit(&entries[i].calls,
+                                                 memory_order_relaxed);
+            stats->trips += atomic_load_explicit(&entries[i].trips,
+                                                 memory_order_relaxed);
+        }
     }
+    return 0;
+}
 
-    if (optind >= argc) {
-        usage(argv[0]);
-    }
+/* The previous entries of a guarded function are saved with all their
+ * qualifiers, in memory that is not allocated using our own malloc. */
+struct trip_guard
+trip_guard_acquire(const char *func, double chance, int error)
+{
+    struct trip_guard guard = { .func = func, .state = -1 };
 
-    char *entry = NULL, *s;
-    entry = strtok_r(argv[optind++], ",", &s);
-    do {
-        enter(entry);
-    } while ((entry = strtok_r(NULL, ",", &s)));
+    init();
 
-    if (optind >= argc) {
-        usage(argv[0]);
+    const char *name = check(func);
+    unsigned n = 0;
+    for (unsigned i = 0; NULL != name && i < count; ++i) {
+        n += name == entries[i].name;
     }
-
-    /* Construct configuration */
-    conf = NULL;
-    size_t size = 0;
-    FILE *h = open_memstream(&conf, &size);
-    if (NULL == h) {
-        fail("open_memstream", true);
+    if (0 < n) {
+        struct entry *saved = REAL(malloc)(n * sizeof *saved);
+        if (NULL == saved) {
+            return guard;
+        }
+        for (unsigned i = 0, j = 0; i < count; ++i) {
+            if (name == entries[i].name) {
+                saved[j++] = entries[i];
+            }
+        }
+        guard.saved = saved;
+        guard.nsaved = n;
     }
 
-    if (0 > fprintf(h, "%s=", ENVCONFNAME)) {
-        fail("printf", true);
-    }
-    if (debug_mode) {
-        if (EOF == putc('D', h)) {
-            fail("putc", true);
-        }
+    if (0 == trip_set(func, chance, error)) {
+        guard.state = 0;
+    } else {
+        free(guard.saved);
+        guard.saved = NULL;
     }
-    for (unsigned i = 0; i < count; ++i) {
-        if (0 > fprintf(h, "%s" GS "%a" GS "%x" RS,
-                        entries[i].name, entries[i].chance,
-                        entries[i].error)) {
-            fail("printf", true);
-        }
-    }
-    fclose(h);
-
-    /* Get path to the shared library */
-    for (size_t size = 1<<6; ; size += 1<<6) {
-        char preload[size];
-        debugf("resolving /proc/self/exe with %lu byte", size);
-
-        strncpy(preload, "LD_PRELOAD=", sizeof preload);
-        size_t prefix = strlen(preload);
-#ifdef __linux__
-        ssize_t ret = readlink("/proc/self/exe", preload + prefix,
-                               sizeof preload - prefix);
-
-        assert(-1 <= ret);
-        if (-1 == ret) {
-            fail("readlink", true);
-        }
-        if (sizeof preload - prefix == (size_t) ret) {
-            /* the memory automatically allocated in PRELOAD was not
-             * sufficient to store the resolved file name.  We will
-             * proceed to allocate more memory and and attempt
-             * resolving the symbolic link path again. */
-            continue;
-        }
-        assert('\0' == preload[prefix + (size_t)ret]);
-#else
-#error "System is not supported"
-#endif
+    return guard;
+}
 
-        execvpe(argv[optind], argv + optind, (char*[]) {preload, conf, NULL});
-        fail("exec", true);
+void
+trip_guard_release(struct trip_guard *guard)
+{
+    if (0 == guard->state && 0 == trip_unset(guard->func)) {
+        struct entry *saved = guard->saved;
+        for (unsigned i = 0; i < guard->nsaved && count < LENGTH(entries); ++i) {
+            entries[count++] = saved[i];
+        }
+        compile();
     }
+    free(guard->saved);
+    guard->saved = NULL;
+    guard->state = -1;
 }
@@ -19,4 +19,34 @@
 
 #define LENGTH(arr) (unsigned) (sizeof(arr)/sizeof(*(arr)))
 
-bool ____trip_should_fail(const char *name, const int *errv, size_t errn);
+struct sockaddr;
+
+/* The network destination of a call, for rules restricted to certain
+ * addresses.  If ADDR is NULL, the address is queried from the socket
+ * FD instead, either its peer or, if LOCAL is set, its own address.
+ * RESET is set if the call changes or closes FD, so that the cached
+ * addresses of FD have to be forgotten. */
+struct ____trip_where {
+    const struct sockaddr *addr;
+    unsigned addrlen;
+    int fd;
+    bool local;
+    bool reset;
+};
+
+/* Pseudo error value for calls that should return a partial count.
+ * Instead of failing, the predicate reduces *PART to a random value
+ * between 1 and *PART - 1, if it is greater than 1. */
+#define ____TRIP_SHORT (-1)
+
+/* Milliseconds the current thread has to wait after the real call
+ * returns, see the "jitter" qualifier. */
+extern _Thread_local unsigned ____trip_jitter;
+void ____trip_late(unsigned ms);
+
+/* Forget the cached addresses of FD, a descriptor that was just
+ * returned by a call and might have had another owner before. */
+void ____trip_renew(int fd);
+
+bool ____trip_should_fail_at(const char *name, const struct ____trip_where *where,
+                             size_t *part, const int *errv, size_t errn);